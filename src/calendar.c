@@ -17,45 +17,375 @@
  * Copyright (C) 2008-2015, Victor Ananjevsky <ananasik@gmail.com>
  */
 
+#include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
 
 #include "yad.h"
 
 static GtkWidget *calendar;
 
-static GHashTable *details;
+/* details entry. value is an offset in the mapped details file */
+typedef struct {
+  gsize value;
+  gsize len;
+} YadDetail;
+
+#define YAD_DETAILS_TAIL 256
+
+static GHashTable *details = NULL;
+static GMappedFile *details_map = NULL;
+static GFileMonitor *details_monitor = NULL;
+static guint reload_timeout = 0;
+
+/* state of the indexed file, for recognizing appends */
+static struct stat details_st;
+static gchar details_tail[YAD_DETAILS_TAIL];
+static gsize details_tail_len = 0;
+
+/* details are looked up by date in --date-format, so dates in other forms are normalized.
+ * key which is not a date is kept as is */
+static gchar *
+detail_key (const gchar * p, gsize len)
+{
+  static GDate *d = NULL;
+  gchar *key, buf[128];
+
+  if (!d)
+    d = g_date_new ();
+
+  key = g_strndup (p, len);
+  g_date_set_parse (d, key);
+  if (g_date_valid (d) && g_date_strftime (buf, sizeof (buf), options.common_data.date_format, d) > 0)
+    {
+      g_free (key);
+      key = g_strdup (buf);
+    }
 
+  return key;
+}
+
+/* add lines in form "DATE TEXT" to index. the last line for a date wins */
 static void
-parse_details ()
+index_details (const gchar * text, gsize start, gsize size)
 {
-  FILE *f;
+  const gchar *p = text + start, *end = text + size;
+
+  while (p < end)
+    {
+      const gchar *nl = memchr (p, '\n', end - p);
+      const gchar *le = nl ? nl : end;
+      const gchar *sp = memchr (p, ' ', le - p);
+
+      if (sp && sp > p)
+        {
+          YadDetail *d = g_new (YadDetail, 1);
+
+          d->value = sp + 1 - text;
+          d->len = le - sp - 1;
+          if (d->len && sp[d->len] == '\r')
+            d->len--;
+          g_hash_table_replace (details, detail_key (p, sp - p), d);
+        }
+
+      p = le + 1;
+    }
+}
 
-  details = g_hash_table_new (g_str_hash, g_str_equal);
+static void
+load_details (void)
+{
+  GMappedFile *map;
+  struct stat st;
+  const gchar *text;
+  gsize size;
+  gboolean append;
+  gint fd;
+  GError *err = NULL;
 
-  /* open details file */
-  f = fopen (options.calendar_data.details, "r");
-  if (f == NULL)
+  fd = open (options.calendar_data.details, O_RDONLY);
+  if (fd == -1 || fstat (fd, &st) == -1)
     {
-      g_printerr (_("Cannot open file '%s': %s\n"), options.common_data.uri, g_strerror (errno));
+      g_printerr (_("Cannot open file '%s': %s\n"), options.calendar_data.details, g_strerror (errno));
+      if (fd != -1)
+        close (fd);
       return;
     }
+  map = g_mapped_file_new_from_fd (fd, FALSE, &err);
+  close (fd);
+  if (!map)
+    {
+      g_printerr (_("Cannot open file '%s': %s\n"), options.calendar_data.details, err->message);
+      g_error_free (err);
+      return;
+    }
+  text = g_mapped_file_get_contents (map);
+  size = text ? g_mapped_file_get_length (map) : 0;
+
+  /* mapping shows the current content, so appending is recognized by the same file,
+   * which didn't shrink and still has the saved end of the indexed text */
+  append = (details_st.st_ino == st.st_ino && details_st.st_dev == st.st_dev &&
+            size >= (gsize) details_st.st_size && details_tail_len > 0 &&
+            memcmp (text + details_st.st_size - details_tail_len, details_tail, details_tail_len) == 0);
+
+  if (append)
+    {
+      /* only the new lines are indexed, started from the last old line, which may be continued */
+      gsize start = details_st.st_size;
+
+      while (start > 0 && text[start - 1] != '\n')
+        start--;
+      index_details (text, start, size);
+    }
+  else
+    {
+      g_hash_table_remove_all (details);
+      index_details (text, 0, size);
+    }
+
+  details_st = st;
+  details_st.st_size = size;
+  details_tail_len = MIN (size, YAD_DETAILS_TAIL);
+  if (details_tail_len)
+    memcpy (details_tail, text + size - details_tail_len, details_tail_len);
+
+  if (details_map)
+    g_mapped_file_unref (details_map);
+  details_map = map;
+}
+
+static gboolean
+reload_details_cb (gpointer data)
+{
+  reload_timeout = 0;
+  load_details ();
+  gtk_widget_queue_resize (calendar);
+  return FALSE;
+}
+
+static void
+details_changed_cb (GFileMonitor * mon, GFile * file, GFile * other, GFileMonitorEvent ev, gpointer data)
+{
+  if (ev != G_FILE_MONITOR_EVENT_CHANGED && ev != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+      ev != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  /* file may be truncated, so the old mapping must not be read anymore.
+   * index is kept for appended data, values are shown again after reload */
+  if (details_map)
+    {
+      g_mapped_file_unref (details_map);
+      details_map = NULL;
+    }
+
+  /* series of writes is handled at once */
+  if (reload_timeout)
+    g_source_remove (reload_timeout);
+  reload_timeout = g_timeout_add (300, reload_details_cb, NULL);
+}
+
+static void
+parse_details (void)
+{
+  GFile *file;
+
+  details = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  load_details ();
+
+  /* reload details on changes */
+  file = g_file_new_for_path (options.calendar_data.details);
+  details_monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (details_monitor)
+    g_signal_connect (details_monitor, "changed", G_CALLBACK (details_changed_cb), NULL);
+  g_object_unref (file);
+}
+
+/* details of months from --details-command. months are keyed by year * 12 + month */
+typedef struct {
+  guint key;
+  GHashTable *days;
+  GIOChannel *ch;
+  guint watch;
+  GPid pid;
+} YadMonthDetails;
+
+static GHashTable *months = NULL;
+
+static void
+free_month (YadMonthDetails * md)
+{
+  if (md->ch)
+    {
+      g_source_remove (md->watch);
+      g_io_channel_unref (md->ch);
+    }
+  g_hash_table_destroy (md->days);
+  g_free (md);
+}
+
+static gboolean
+month_output_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
+{
+  YadMonthDetails *md = (YadMonthDetails *) data;
+  GIOStatus status;
+  gboolean changed = FALSE;
 
-  /* read details file */
-  while (!feof (f))
+  /* add every complete line as soon as it arrives */
+  do
     {
-      gchar buf[4096], **dtl;
+      gchar *line = NULL;
+      gsize len, term;
 
-      /* read string */
-      memset (buf, 0, 4096);
-      fgets (buf, 4096, f);
-      if (strlen (buf) > 0)
+      status = g_io_channel_read_line (ch, &line, &len, &term, NULL);
+      if (line)
         {
-          dtl = g_strsplit (buf, " ", 2);
-          g_hash_table_insert (details, dtl[0], dtl[1]);
+          gchar *sp;
+
+          line[term] = '\0';
+          if (term && line[term - 1] == '\r')
+            line[term - 1] = '\0';
+          if ((sp = strchr (line, ' ')) != NULL && sp > line)
+            {
+              *sp = '\0';
+              g_hash_table_replace (md->days, g_strdup (line), g_strdup (sp + 1));
+              changed = TRUE;
+            }
+          g_free (line);
         }
     }
+  while (status == G_IO_STATUS_NORMAL);
+
+  if (changed)
+    {
+      guint y, m, key;
+
+      /* redraw if month is visible */
+      gtk_calendar_get_date (GTK_CALENDAR (calendar), &y, &m, NULL);
+      key = y * 12 + m;
+      if (md->key + 1 >= key && md->key <= key + 1)
+        gtk_widget_queue_resize (calendar);
+    }
+
+  if (status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR)
+    {
+      /* watch is removed by returning FALSE */
+      g_io_channel_unref (md->ch);
+      md->ch = NULL;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+month_exit_cb (GPid pid, gint status, gpointer data)
+{
+  YadMonthDetails *md = (YadMonthDetails *) data;
+
+  g_spawn_close_pid (pid);
+  md->pid = 0;
+}
+
+static void
+month_child_setup (gpointer data)
+{
+  /* own process group for killing all processes of the command */
+  setpgid (0, 0);
+}
+
+/* commands still running when dialog exits are not needed anymore */
+static void
+kill_months (void)
+{
+  GHashTableIter iter;
+  YadMonthDetails *md;
+
+  g_hash_table_iter_init (&iter, months);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & md))
+    {
+      if (md->pid)
+        kill (-md->pid, SIGTERM);
+    }
+}
+
+/* run details command for month, if it was not run yet. month is 0..11 */
+static YadMonthDetails *
+request_month (guint year, guint month)
+{
+  YadMonthDetails *md;
+  gchar **args, **argv;
+  guint key = year * 12 + month, n;
+  gint out;
+  GPid pid;
+  GError *err = NULL;
+
+  if ((md = g_hash_table_lookup (months, GUINT_TO_POINTER (key))) != NULL)
+    return md;
+
+  md = g_new0 (YadMonthDetails, 1);
+  md->key = key;
+  md->days = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  /* failed month is not requested again */
+  g_hash_table_insert (months, GUINT_TO_POINTER (key), md);
+
+  if (!g_shell_parse_argv (options.calendar_data.details_cmd, NULL, &args, &err))
+    {
+      g_printerr (_("Unable to parse command %s: %s\n"), options.calendar_data.details_cmd, err->message);
+      g_error_free (err);
+      return md;
+    }
+
+  /* command gets year and month (1..12) as the last arguments */
+  n = g_strv_length (args);
+  argv = g_new0 (gchar *, n + 3);
+  memcpy (argv, args, n * sizeof (gchar *));
+  argv[n] = g_strdup_printf ("%d", year);
+  argv[n + 1] = g_strdup_printf ("%d", month + 1);
+  g_free (args);
+
+  if (g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                month_child_setup, NULL, &pid, NULL, &out, NULL, &err))
+    {
+      md->pid = pid;
+      g_child_watch_add (md->pid, month_exit_cb, md);
+
+      md->ch = g_io_channel_unix_new (out);
+      g_io_channel_set_encoding (md->ch, NULL, NULL);
+      g_io_channel_set_flags (md->ch, G_IO_FLAG_NONBLOCK, NULL);
+      g_io_channel_set_close_on_unref (md->ch, TRUE);
+      md->watch = g_io_add_watch (md->ch, G_IO_IN | G_IO_HUP | G_IO_ERR, month_output_cb, md);
+    }
+  else
+    {
+      g_printerr (_("Unable to run command %s: %s\n"), options.calendar_data.details_cmd, err->message);
+      g_error_free (err);
+    }
+  g_strfreev (argv);
+
+  return md;
+}
+
+/* load shown month and prefetch its neighbours */
+static void
+month_changed_cb (GtkCalendar * cal, gpointer data)
+{
+  guint y, m;
 
-  fclose (f);
+  gtk_calendar_get_date (cal, &y, &m, NULL);
+  request_month (y, m);
+  if (m > 0)
+    request_month (y, m - 1);
+  else if (y > 0)
+    request_month (y - 1, 11);
+  if (m < 11)
+    request_month (y, m + 1);
+  else
+    request_month (y + 1, 0);
 }
 
 static gchar *
@@ -63,19 +393,31 @@ get_details (GtkCalendar * cal, guint year, guint month, guint day, gpointer dat
 {
   GDate *d;
   gchar time_string[128];
+  YadDetail *dtl = NULL;
   gchar *str = NULL;
 
   d = g_date_new_dmy (day, month + 1, year);
   if (g_date_valid (d))
     {
       g_date_strftime (time_string, 127, options.common_data.date_format, d);
-      str = (gchar *) g_hash_table_lookup (details, time_string);
+      if (months)
+        {
+          /* months are requested on month change, drawing only looks them up */
+          YadMonthDetails *md = g_hash_table_lookup (months, GUINT_TO_POINTER (year * 12 + month));
+
+          if (md)
+            str = (gchar *) g_hash_table_lookup (md->days, time_string);
+        }
+      if (!str && details_map)
+        dtl = (YadDetail *) g_hash_table_lookup (details, time_string);
     }
   g_date_free (d);
 
   if (str)
     return g_strdup (str);
-  return str;
+  if (dtl)
+    return g_strndup (g_mapped_file_get_contents (details_map) + dtl->value, dtl->len);
+  return NULL;
 }
 
 static void
@@ -99,10 +441,16 @@ calendar_create_widget (GtkWidget * dlg)
     gtk_calendar_select_day (GTK_CALENDAR (w), options.calendar_data.day);
 
   if (options.calendar_data.details)
+    parse_details ();
+  if (options.calendar_data.details_cmd)
     {
-      parse_details ();
-      gtk_calendar_set_detail_func (GTK_CALENDAR (w), get_details, NULL, NULL);
+      months = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) free_month);
+      atexit (kill_months);
+      month_changed_cb (GTK_CALENDAR (w), NULL);
+      g_signal_connect (w, "month-changed", G_CALLBACK (month_changed_cb), NULL);
     }
+  if (options.calendar_data.details || options.calendar_data.details_cmd)
+    gtk_calendar_set_detail_func (GTK_CALENDAR (w), get_details, NULL, NULL);
 
   gtk_calendar_set_display_options (GTK_CALENDAR (w),
                                     GTK_CALENDAR_SHOW_HEADING |
@@ -25,35 +25,107 @@
 
 static GtkWidget *color;
 
+/* number of palette lines loaded at once */
+#define PALETTE_CHUNK 500
+
+#define SWATCH_WIDTH 16
+#define SWATCH_HEIGHT 14
+
+typedef struct {
+  FILE *fp;
+  GtkListStore *store;
+  /* one swatch for each distinct color */
+  GHashTable *swatches;
+} YadPalette;
+
+static GdkPixbuf *
+get_swatch (YadPalette * pl, guint32 rgb)
+{
+  GdkPixbuf *pb = g_hash_table_lookup (pl->swatches, GUINT_TO_POINTER (rgb));
+
+  if (!pb)
+    {
+      pb = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, SWATCH_WIDTH, SWATCH_HEIGHT);
+      gdk_pixbuf_fill (pb, (rgb << 8) | 0xff);
+      g_hash_table_insert (pl->swatches, GUINT_TO_POINTER (rgb), pb);
+    }
+
+  return pb;
+}
+
+/* parse line in format "R G B NAME". comments and wrong lines are skipped */
+static gboolean
+parse_color (gchar * buf, guint32 * rgb, gchar ** name)
+{
+  gchar *p = buf, *end;
+  gint i;
+
+  while (g_ascii_isspace (*p))
+    p++;
+  if (!g_ascii_isdigit (*p))
+    return FALSE;
+
+  *rgb = 0;
+  for (i = 0; i < 3; i++)
+    {
+      guint64 v = g_ascii_strtoull (p, &end, 10);
+
+      if (end == p || v > 255)
+        return FALSE;
+      *rgb = (*rgb << 8) | v;
+      p = end;
+    }
+
+  *name = g_strstrip (p);
+  return TRUE;
+}
+
+/* load next chunk of palette. returns FALSE at the end of file */
+static gboolean
+load_palette_chunk (YadPalette * pl)
+{
+  gchar buf[1024];
+  guint n;
+
+  for (n = 0; n < PALETTE_CHUNK; n++)
+    {
+      guint32 rgb;
+      gchar spec[8], *name;
+
+      if (!fgets (buf, sizeof (buf), pl->fp))
+        return FALSE;
+      if (!parse_color (buf, &rgb, &name))
+        continue;
+
+      g_sprintf (spec, "#%.6X", rgb);
+      gtk_list_store_insert_with_values (pl->store, NULL, -1, 0, get_swatch (pl, rgb), 1, spec, 2, name, -1);
+    }
+
+  return TRUE;
+}
+
+static void
+free_palette (YadPalette * pl)
+{
+  fclose (pl->fp);
+  g_hash_table_destroy (pl->swatches);
+  g_object_unref (pl->store);
+  g_free (pl);
+}
+
+static gboolean
+load_palette_cb (gpointer data)
+{
+  return load_palette_chunk ((YadPalette *) data);
+}
+
 static GtkTreeModel *
 create_palette ()
 {
+  YadPalette *pl;
+  GtkListStore *store;
   FILE *fp;
   gchar *filename;
-  gchar buf[1024], *name;
-  GtkListStore *store;
-  GdkPixbuf *pb;
-  GtkTreeIter iter;
-
-  gchar *cxpm[] = {
-    "16 14 1 1",
-    ". c #FFFFFF",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................",
-    "................"
-  };
-  gchar cl[] = ". c #FFFFFF";
 
   if (options.color_data.palette)
     filename = options.color_data.palette;
@@ -66,31 +138,17 @@ create_palette ()
       return NULL;
     }
 
+  pl = g_new0 (YadPalette, 1);
+  pl->fp = fp;
   store = gtk_list_store_new (3, GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_STRING);
+  pl->store = g_object_ref (store);
+  pl->swatches = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
 
-  while ((name = fgets (buf, sizeof (buf), fp)) != NULL)
-    {
-      gint r, g, b;
-      gchar spec[8];
-
-      if (buf[0] == '!')
-        continue;
-
-      sscanf (buf, "%d %d %d", &r, &g, &b);
-
-      g_sprintf (spec, "#%.2X%.2X%.2X", r, g, b);
-      g_sprintf (cl, ". c #%.2X%.2X%.2X", r, g, b);
-      cxpm[1] = cl;
-      pb = gdk_pixbuf_new_from_xpm_data ((const gchar **) cxpm);
-
-      while (g_ascii_isdigit (*name) || g_ascii_isspace (*name))
-        name++;
-
-      gtk_list_store_append (store, &iter);
-      gtk_list_store_set (store, &iter, 0, pb, 1, spec, 2, g_strstrip (name), -1);
-    }
-
-  fclose (fp);
+  /* first chunk is shown at once, the rest is loaded in idle */
+  if (load_palette_chunk (pl))
+    g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, load_palette_cb, pl, (GDestroyNotify) free_palette);
+  else
+    free_palette (pl);
 
   return GTK_TREE_MODEL (store);
 }
@@ -112,6 +170,59 @@ palette_changed (GtkTreeSelection * sel, gpointer data)
     }
 }
 
+static gchar *
+get_color_string (void)
+{
+  GdkColor c;
+  guint16 alpha;
+  gchar *cs, *res = NULL;
+
+  gtk_color_selection_get_current_color (GTK_COLOR_SELECTION (color), &c);
+  alpha = gtk_color_selection_get_current_alpha (GTK_COLOR_SELECTION (color));
+
+  switch (options.color_data.mode)
+    {
+    case YAD_COLOR_HEX:
+      cs = gdk_color_to_string (&c);
+      if (options.color_data.alpha)
+        {
+          if (options.color_data.extra)
+            res = g_strdup_printf ("#%s%hx", cs + 1, alpha);
+          else
+            res = g_strdup_printf ("#%c%c%c%c%c%c%hx", cs[1], cs[2], cs[5], cs[6], cs[9], cs[10], alpha / 256);
+        }
+      else
+        {
+          if (options.color_data.extra)
+            res = g_strdup (cs);
+          else
+            res = g_strdup_printf ("#%c%c%c%c%c%c", cs[1], cs[2], cs[5], cs[6], cs[9], cs[10]);
+        }
+      g_free (cs);
+      break;
+    case YAD_COLOR_RGB:
+      if (options.color_data.alpha)
+        res = g_strdup_printf ("rgba(%.1f, %.1f, %.1f, %.1f)", (double) c.red / 255.0, (double) c.green / 255.0,
+                               (double) c.blue / 255.0, (double) alpha / 255 / 255);
+      else
+        res = g_strdup_printf ("rgb(%.1f, %.1f, %.1f)", (double) c.red / 255.0, (double) c.green / 255.0,
+                               (double) c.blue / 255.0);
+      break;
+    }
+
+  return res;
+}
+
+static void
+print_changes_cb (GtkColorSelection * sel, gpointer data)
+{
+  gchar *cs = get_color_string ();
+
+  if (cs)
+    print_change (0, cs);
+  g_free (cs);
+}
+
 GtkWidget *
 color_create_widget (GtkWidget * dlg)
 {
@@ -135,6 +246,9 @@ color_create_widget (GtkWidget * dlg)
     }
   gtk_box_pack_start (GTK_BOX (w), color, FALSE, FALSE, 2);
 
+  if (options.common_data.print_changes)
+    g_signal_connect (G_OBJECT (color), "color-changed", G_CALLBACK (print_changes_cb), NULL);
+
   if (options.color_data.use_palette)
     {
       GtkTreeModel *model;
@@ -205,39 +319,9 @@ color_create_widget (GtkWidget * dlg)
 void
 color_print_result (void)
 {
-  GdkColor c;
-  guint16 alpha;
-  gchar *cs = NULL;
-
-  gtk_color_selection_get_current_color (GTK_COLOR_SELECTION (color), &c);
-  alpha = gtk_color_selection_get_current_alpha (GTK_COLOR_SELECTION (color));
+  gchar *cs = get_color_string ();
 
-  switch (options.color_data.mode)
-    {
-    case YAD_COLOR_HEX:
-      cs = gdk_color_to_string (&c);
-      if (options.color_data.alpha)
-        {
-          if (options.color_data.extra)
-            g_print ("#%s%hx\n", cs + 1, alpha);
-          else
-            g_printf ("#%c%c%c%c%c%c%hx\n", cs[1], cs[2], cs[5], cs[6], cs[9], cs[10], alpha / 256);
-        }
-      else
-        {
-          if (options.color_data.extra)
-            g_print ("%s\n", cs);
-          else
-            g_printf ("#%c%c%c%c%c%c\n", cs[1], cs[2], cs[5], cs[6], cs[9], cs[10]);
-        }
-      g_free (cs);
-      break;
-    case YAD_COLOR_RGB:
-      if (options.color_data.alpha)
-        g_print ("rgba(%.1f, %.1f, %.1f, %.1f)\n", (double) c.red / 255.0, (double) c.green / 255.0,
-                 (double) c.blue / 255.0, (double) alpha / 255 / 255);
-      else
-        g_print ("rgb(%.1f, %.1f, %.1f)\n", (double) c.red / 255.0, (double) c.green / 255.0, (double) c.blue / 255.0);
-      break;
-    }
+  if (cs)
+    g_print ("%s\n", cs);
+  g_free (cs);
 }
@@ -0,0 +1,650 @@
+/*
+ * This file is part of YAD.
+ *
+ * YAD is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * YAD is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with YAD. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008-2015, Victor Ananjevsky <ananasik@gmail.com>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "yad.h"
+
+/* maximum number of items in completion popup */
+#define YAD_MAX_MATCHES 100
+/* delay after the last keystroke before running completion command */
+#define YAD_COMMAND_DELAY 150
+/* maximum number of cached results of completion command */
+#define YAD_COMMAND_CACHE 256
+
+typedef struct {
+  gchar *key;
+  gchar *item;
+  gint score;
+} YadCompletionItem;
+
+typedef struct {
+  gchar *key;
+  guint gen;
+} YadCompletionQuery;
+
+/* completion index of the entry. items are sorted by casefolded keys.
+ * index is built and searched by worker thread, results are applied in idle */
+typedef struct {
+  GtkWidget *entry;
+  GtkListStore *matches;
+  gboolean fuzzy;
+
+  YadCompletionItem *items;
+  guint n_items;
+
+  GThreadPool *pool;
+  volatile gint gen;
+  /* held by the entry and by every queued job. the last one frees the index */
+  volatile gint ref;
+  volatile gint dead;
+
+  GMutex lock;
+  GPtrArray *result;
+  guint idle;
+} YadCompletion;
+
+static gint
+item_cmp (gconstpointer a, gconstpointer b)
+{
+  return strcmp (((YadCompletionItem *) a)->key, ((YadCompletionItem *) b)->key);
+}
+
+static gint
+score_cmp (gconstpointer a, gconstpointer b)
+{
+  const YadCompletionItem *ia = *(YadCompletionItem **) a;
+  const YadCompletionItem *ib = *(YadCompletionItem **) b;
+
+  if (ia->score != ib->score)
+    return ib->score - ia->score;
+  return strcmp (ia->key, ib->key);
+}
+
+/* score of fuzzy match. query chars must be found in key in the same order.
+ * consecutive chars and chars at word starts are ranked higher, gaps and long keys lower */
+static gint
+fuzzy_score (const gchar * key, const gchar * query)
+{
+  const gchar *k = key, *q = query;
+  const gchar *prev = NULL;
+  gint score = 0;
+
+  while (*q)
+    {
+      gunichar qc = g_utf8_get_char (q);
+      const gchar *start = k;
+
+      while (*k && g_utf8_get_char (k) != qc)
+        k = g_utf8_next_char (k);
+      if (!*k)
+        return -1;
+
+      if (k == key)
+        score += 16;
+      else if (!g_unichar_isalnum (g_utf8_get_char (g_utf8_prev_char (k))))
+        score += 8;
+      if (prev && k == g_utf8_next_char (prev))
+        score += 12;
+      else
+        score -= MIN (k - start, 8);
+
+      prev = k;
+      k = g_utf8_next_char (k);
+      q = g_utf8_next_char (q);
+    }
+
+  return score - (gint) MIN (strlen (key) / 4, 16);
+}
+
+/* search matches in sorted items. prefix matches go first, then substring matches */
+static GPtrArray *
+find_matches (YadCompletion * c, YadCompletionQuery * q)
+{
+  GPtrArray *res = g_ptr_array_new ();
+  guint lo = 0, hi = c->n_items, i;
+
+  /* binary search for the first key not less than the query */
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+      if (strcmp (c->items[mid].key, q->key) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  for (i = lo; i < c->n_items && res->len < YAD_MAX_MATCHES && g_str_has_prefix (c->items[i].key, q->key); i++)
+    g_ptr_array_add (res, &c->items[i]);
+
+  for (i = 0; i < c->n_items && res->len < YAD_MAX_MATCHES; i++)
+    {
+      /* stop if user already typed something new */
+      if ((i & 0xfff) == 0 && (guint) g_atomic_int_get (&c->gen) != q->gen)
+        break;
+      if (!g_str_has_prefix (c->items[i].key, q->key) && strstr (c->items[i].key, q->key))
+        g_ptr_array_add (res, &c->items[i]);
+    }
+
+  return res;
+}
+
+/* rank all items by fuzzy score and keep the best ones */
+static GPtrArray *
+find_fuzzy_matches (YadCompletion * c, YadCompletionQuery * q)
+{
+  GPtrArray *res = g_ptr_array_sized_new (YAD_MAX_MATCHES + 1);
+  guint i;
+
+  for (i = 0; i < c->n_items; i++)
+    {
+      YadCompletionItem *it = &c->items[i];
+      gint score;
+      guint j;
+
+      if ((i & 0xfff) == 0 && (guint) g_atomic_int_get (&c->gen) != q->gen)
+        break;
+
+      score = fuzzy_score (it->key, q->key);
+      if (score < 0)
+        continue;
+      if (res->len == YAD_MAX_MATCHES &&
+          score <= ((YadCompletionItem *) g_ptr_array_index (res, res->len - 1))->score)
+        continue;
+
+      /* items are only scored by this thread, so score may be stored in place */
+      it->score = score;
+      for (j = res->len; j > 0 && ((YadCompletionItem *) g_ptr_array_index (res, j - 1))->score < score; j--);
+      g_ptr_array_add (res, NULL);
+      memmove (res->pdata + j + 1, res->pdata + j, (res->len - j - 1) * sizeof (gpointer));
+      res->pdata[j] = it;
+      if (res->len > YAD_MAX_MATCHES)
+        g_ptr_array_set_size (res, YAD_MAX_MATCHES);
+    }
+
+  g_ptr_array_sort (res, score_cmp);
+
+  return res;
+}
+
+static gboolean
+apply_matches_cb (gpointer data)
+{
+  YadCompletion *c = (YadCompletion *) data;
+  GPtrArray *res;
+  guint i;
+
+  g_mutex_lock (&c->lock);
+  res = c->result;
+  c->result = NULL;
+  c->idle = 0;
+  g_mutex_unlock (&c->lock);
+
+  gtk_list_store_clear (c->matches);
+  if (res)
+    {
+      for (i = 0; i < res->len; i++)
+        {
+          YadCompletionItem *it = g_ptr_array_index (res, i);
+          gtk_list_store_insert_with_values (c->matches, NULL, -1, 0, it->item, -1);
+        }
+      g_ptr_array_free (res, TRUE);
+
+      /* popup may be already checked by completion itself */
+      if (gtk_widget_has_focus (c->entry))
+        gtk_entry_completion_complete (gtk_entry_get_completion (GTK_ENTRY (c->entry)));
+    }
+
+  return FALSE;
+}
+
+static void
+completion_unref (YadCompletion * c)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&c->ref))
+    return;
+
+  if (c->result)
+    g_ptr_array_free (c->result, TRUE);
+  g_mutex_clear (&c->lock);
+  for (i = 0; i < c->n_items; i++)
+    {
+      g_free (c->items[i].key);
+      g_free (c->items[i].item);
+    }
+  g_free (c->items);
+  g_free (c);
+}
+
+static void
+push_query (YadCompletion * c, YadCompletionQuery * q)
+{
+  g_atomic_int_inc (&c->ref);
+  g_thread_pool_push (c->pool, q, NULL);
+}
+
+static void
+completion_func (gpointer data, gpointer user_data)
+{
+  YadCompletionQuery *q = (YadCompletionQuery *) data;
+  YadCompletion *c = (YadCompletion *) user_data;
+  GPtrArray *res = NULL;
+
+  if (!q->key)
+    {
+      /* first job sorts the index */
+      guint i;
+
+      for (i = 0; i < c->n_items && !g_atomic_int_get (&c->dead); i++)
+        c->items[i].key = g_utf8_casefold (c->items[i].item, -1);
+      /* replaced index is never searched */
+      if (!g_atomic_int_get (&c->dead))
+        qsort (c->items, c->n_items, sizeof (YadCompletionItem), item_cmp);
+      g_free (q);
+      completion_unref (c);
+      return;
+    }
+
+  if ((guint) g_atomic_int_get (&c->gen) == q->gen && q->key[0])
+    res = c->fuzzy ? find_fuzzy_matches (c, q) : find_matches (c, q);
+
+  g_mutex_lock (&c->lock);
+  if ((guint) g_atomic_int_get (&c->gen) == q->gen)
+    {
+      if (c->result)
+        g_ptr_array_free (c->result, TRUE);
+      c->result = res;
+      res = NULL;
+      if (!c->idle)
+        c->idle = g_idle_add (apply_matches_cb, c);
+    }
+  g_mutex_unlock (&c->lock);
+
+  if (res)
+    g_ptr_array_free (res, TRUE);
+  g_free (q->key);
+  g_free (q);
+  completion_unref (c);
+}
+
+static void
+text_changed_cb (GtkEntry * e, YadCompletion * c)
+{
+  YadCompletionQuery *q = g_new0 (YadCompletionQuery, 1);
+
+  q->key = g_utf8_casefold (gtk_entry_get_text (e), -1);
+  q->gen = (guint) g_atomic_int_add (&c->gen, 1) + 1;
+  push_query (c, q);
+}
+
+static gboolean
+match_all_func (GtkEntryCompletion * ec, const gchar * key, GtkTreeIter * iter, gpointer data)
+{
+  /* matches are already selected by the index */
+  return TRUE;
+}
+
+/* entry doesn't wait for the worker. queued jobs see new generation and return at once,
+ * the index is freed by the last of them */
+static void
+free_completion (YadCompletion * c)
+{
+  g_atomic_int_set (&c->dead, 1);
+  g_atomic_int_inc (&c->gen);
+
+  g_mutex_lock (&c->lock);
+  if (c->idle)
+    g_source_remove (c->idle);
+  c->idle = 0;
+  g_mutex_unlock (&c->lock);
+
+  g_object_unref (c->matches);
+  c->matches = NULL;
+
+  g_thread_pool_free (c->pool, FALSE, FALSE);
+  completion_unref (c);
+}
+
+/* set completion of entry to the indexed list of items. items are owned by completion after call.
+ * items may be NULL for empty list */
+void
+set_completion (GtkWidget * entry, gchar ** items, gboolean fuzzy)
+{
+  YadCompletion *c;
+  GtkEntryCompletion *ec;
+  guint i;
+
+  c = g_new0 (YadCompletion, 1);
+  c->entry = entry;
+  c->fuzzy = fuzzy;
+  c->ref = 1;
+  g_mutex_init (&c->lock);
+
+  c->n_items = items ? g_strv_length (items) : 0;
+  c->items = g_new0 (YadCompletionItem, c->n_items);
+  for (i = 0; i < c->n_items; i++)
+    c->items[i].item = items[i];
+  g_free (items);
+
+  c->matches = gtk_list_store_new (1, G_TYPE_STRING);
+
+  /* one worker keeps jobs in order, so queries always wait for the index */
+  c->pool = g_thread_pool_new (completion_func, c, 1, FALSE, NULL);
+  push_query (c, g_new0 (YadCompletionQuery, 1));
+
+  ec = gtk_entry_get_completion (GTK_ENTRY (entry));
+  if (!ec)
+    {
+      ec = gtk_entry_completion_new ();
+      gtk_entry_set_completion (GTK_ENTRY (entry), ec);
+      gtk_entry_completion_set_text_column (ec, 0);
+      g_object_unref (ec);
+    }
+  gtk_entry_completion_set_model (ec, GTK_TREE_MODEL (c->matches));
+  gtk_entry_completion_set_match_func (ec, match_all_func, NULL, NULL);
+
+  /* replace previous completion */
+  g_signal_handlers_disconnect_matched (entry, G_SIGNAL_MATCH_FUNC, 0, 0, NULL, text_changed_cb, NULL);
+  g_object_set_data_full (G_OBJECT (entry), "yad-completion", c, (GDestroyNotify) free_completion);
+  g_signal_connect (G_OBJECT (entry), "changed", G_CALLBACK (text_changed_cb), c);
+}
+
+/* completion from command output. command gets current text as the last argument */
+typedef struct _YadCompletionJob YadCompletionJob;
+
+typedef struct {
+  GtkWidget *entry;
+  GtkListStore *matches;
+  gchar **argv;
+  guint timeout;
+  /* results of finished queries by text */
+  GHashTable *cache;
+  YadCompletionJob *job;
+} YadCompletionCommand;
+
+struct _YadCompletionJob {
+  YadCompletionCommand *cc;
+  gchar *text;
+  GPtrArray *lines;
+  GPid pid;
+  GIOChannel *ch;
+  guint watch;
+  gint status;
+  gboolean running;
+  gboolean full;
+};
+
+static void
+set_matches (YadCompletionCommand * cc, GPtrArray * lines)
+{
+  guint i;
+
+  gtk_list_store_clear (cc->matches);
+  for (i = 0; i < lines->len; i++)
+    gtk_list_store_insert_with_values (cc->matches, NULL, -1, 0, g_ptr_array_index (lines, i), -1);
+
+  if (gtk_widget_has_focus (cc->entry))
+    gtk_entry_completion_complete (gtk_entry_get_completion (GTK_ENTRY (cc->entry)));
+}
+
+/* called when both output is read and the command is exited */
+static void
+finish_job (YadCompletionJob * j)
+{
+  if (j->ch || j->running)
+    return;
+
+  /* stale jobs are detached from completion */
+  if (j->cc && (j->full || (WIFEXITED (j->status) && WEXITSTATUS (j->status) == 0)))
+    {
+      YadCompletionCommand *cc = j->cc;
+
+      if (g_hash_table_size (cc->cache) >= YAD_COMMAND_CACHE)
+        g_hash_table_remove_all (cc->cache);
+      g_hash_table_replace (cc->cache, j->text, j->lines);
+      j->text = NULL;
+      j->lines = NULL;
+    }
+  if (j->cc)
+    j->cc->job = NULL;
+
+  g_free (j->text);
+  if (j->lines)
+    g_ptr_array_free (j->lines, TRUE);
+  g_free (j);
+}
+
+static void
+stop_job_reading (YadCompletionJob * j)
+{
+  if (j->ch)
+    {
+      g_source_remove (j->watch);
+      g_io_channel_unref (j->ch);
+      j->ch = NULL;
+    }
+}
+
+/* kill running query. its output is not needed anymore */
+static void
+cancel_job (YadCompletionJob * j)
+{
+  if (j->running)
+    kill (-j->pid, SIGTERM);
+  stop_job_reading (j);
+  j->cc->job = NULL;
+  j->cc = NULL;
+  finish_job (j);
+}
+
+static gboolean
+job_output_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
+{
+  YadCompletionJob *j = (YadCompletionJob *) data;
+  GIOStatus status;
+  guint n = j->lines->len;
+
+  /* add every complete line as soon as it arrives */
+  do
+    {
+      gchar *line = NULL;
+      gsize len, term;
+
+      status = g_io_channel_read_line (ch, &line, &len, &term, NULL);
+      if (line)
+        {
+          line[term] = '\0';
+          g_ptr_array_add (j->lines, line);
+          gtk_list_store_insert_with_values (j->cc->matches, NULL, -1, 0, line, -1);
+          if (j->lines->len >= YAD_MAX_MATCHES)
+            {
+              /* the rest of output will not be shown anyway */
+              j->full = TRUE;
+              if (j->running)
+                kill (-j->pid, SIGTERM);
+              break;
+            }
+        }
+    }
+  while (status == G_IO_STATUS_NORMAL);
+
+  if (j->lines->len > n && gtk_widget_has_focus (j->cc->entry))
+    gtk_entry_completion_complete (gtk_entry_get_completion (GTK_ENTRY (j->cc->entry)));
+
+  if (j->full || status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR)
+    {
+      /* watch is removed by returning FALSE */
+      g_io_channel_unref (j->ch);
+      j->ch = NULL;
+      finish_job (j);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+job_exit_cb (GPid pid, gint status, gpointer data)
+{
+  YadCompletionJob *j = (YadCompletionJob *) data;
+
+  g_spawn_close_pid (pid);
+  j->status = status;
+  j->running = FALSE;
+  finish_job (j);
+}
+
+static void
+job_child_setup (gpointer data)
+{
+  /* own process group for killing all processes of the query */
+  setpgid (0, 0);
+}
+
+static void
+run_job (YadCompletionCommand * cc, const gchar * text)
+{
+  YadCompletionJob *j;
+  gchar **argv;
+  guint n;
+  GPid pid;
+  gint out;
+  GError *err = NULL;
+
+  n = g_strv_length (cc->argv);
+  argv = g_new0 (gchar *, n + 2);
+  memcpy (argv, cc->argv, n * sizeof (gchar *));
+  argv[n] = (gchar *) text;
+
+  if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                 job_child_setup, NULL, &pid, NULL, &out, NULL, &err))
+    {
+      g_printerr (_("Unable to run command %s: %s\n"), argv[0], err->message);
+      g_error_free (err);
+      g_free (argv);
+      return;
+    }
+  g_free (argv);
+
+  j = g_new0 (YadCompletionJob, 1);
+  j->cc = cc;
+  j->text = g_strdup (text);
+  j->lines = g_ptr_array_new_with_free_func (g_free);
+  j->pid = pid;
+  j->running = TRUE;
+
+  j->ch = g_io_channel_unix_new (out);
+  g_io_channel_set_encoding (j->ch, NULL, NULL);
+  g_io_channel_set_flags (j->ch, G_IO_FLAG_NONBLOCK, NULL);
+  g_io_channel_set_close_on_unref (j->ch, TRUE);
+  j->watch = g_io_add_watch (j->ch, G_IO_IN | G_IO_HUP | G_IO_ERR, job_output_cb, j);
+
+  g_child_watch_add (j->pid, job_exit_cb, j);
+
+  cc->job = j;
+}
+
+static gboolean
+query_cb (gpointer data)
+{
+  YadCompletionCommand *cc = (YadCompletionCommand *) data;
+  const gchar *text = gtk_entry_get_text (GTK_ENTRY (cc->entry));
+  GPtrArray *lines;
+
+  cc->timeout = 0;
+
+  if ((lines = g_hash_table_lookup (cc->cache, text)) != NULL)
+    set_matches (cc, lines);
+  else
+    {
+      gtk_list_store_clear (cc->matches);
+      run_job (cc, text);
+    }
+
+  return FALSE;
+}
+
+static void
+command_text_changed_cb (GtkEntry * e, YadCompletionCommand * cc)
+{
+  if (cc->job)
+    cancel_job (cc->job);
+
+  if (cc->timeout)
+    g_source_remove (cc->timeout);
+  cc->timeout = 0;
+
+  if (gtk_entry_get_text (e)[0])
+    cc->timeout = g_timeout_add (YAD_COMMAND_DELAY, query_cb, cc);
+  else
+    gtk_list_store_clear (cc->matches);
+}
+
+static void
+free_completion_command (YadCompletionCommand * cc)
+{
+  if (cc->job)
+    cancel_job (cc->job);
+  if (cc->timeout)
+    g_source_remove (cc->timeout);
+
+  g_hash_table_destroy (cc->cache);
+  g_strfreev (cc->argv);
+  g_object_unref (cc->matches);
+  g_free (cc);
+}
+
+/* set completion of entry to output of command. each line of output is a completion item */
+void
+set_completion_command (GtkWidget * entry, const gchar * cmd)
+{
+  YadCompletionCommand *cc;
+  GtkEntryCompletion *ec;
+  gchar **argv;
+  GError *err = NULL;
+
+  if (!g_shell_parse_argv (cmd, NULL, &argv, &err))
+    {
+      g_printerr (_("Unable to parse command %s: %s\n"), cmd, err->message);
+      g_error_free (err);
+      return;
+    }
+
+  cc = g_new0 (YadCompletionCommand, 1);
+  cc->entry = entry;
+  cc->argv = argv;
+  cc->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  cc->matches = gtk_list_store_new (1, G_TYPE_STRING);
+
+  ec = gtk_entry_completion_new ();
+  gtk_entry_set_completion (GTK_ENTRY (entry), ec);
+  gtk_entry_completion_set_text_column (ec, 0);
+  gtk_entry_completion_set_model (ec, GTK_TREE_MODEL (cc->matches));
+  gtk_entry_completion_set_match_func (ec, match_all_func, NULL, NULL);
+  g_object_unref (ec);
+
+  g_object_set_data_full (G_OBJECT (entry), "yad-completion-command", cc, (GDestroyNotify) free_completion_command);
+  g_signal_connect (G_OBJECT (entry), "changed", G_CALLBACK (command_text_changed_cb), cc);
+}
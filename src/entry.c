@@ -17,6 +17,11 @@
  * Copyright (C) 2008-2015, Victor Ananjevsky <ananasik@gmail.com>
  */
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+
 #include <gdk/gdkkeysyms.h>
 
 #include "yad.h"
@@ -47,6 +52,193 @@ combo_activate_cb (GtkWidget * w, GdkEventKey * ev, gpointer data)
   return FALSE;
 }
 
+/* running icon action. only one action may run at once */
+typedef struct {
+  GtkWidget *entry;
+  GPid pid;
+  GIOChannel *ch;
+  guint watch;
+  guint timeout;
+  guint pulse;
+  GString *out;
+  gint status;
+  gboolean running;
+  gboolean cancelled;
+} YadIconAction;
+
+static YadIconAction *icon_action = NULL;
+
+/* called when both output is read and the command is exited */
+static void
+finish_icon_action (YadIconAction * a)
+{
+  if (a->ch || a->running)
+    return;
+
+  if (!a->cancelled && WIFEXITED (a->status) && WEXITSTATUS (a->status) == 0)
+    {
+      if (a->out->len && a->out->str[a->out->len - 1] == '\n')
+        g_string_truncate (a->out, a->out->len - 1);
+      gtk_entry_set_text (GTK_ENTRY (a->entry), a->out->str);
+      /* move cursor to the end of text */
+      gtk_editable_set_position (GTK_EDITABLE (a->entry), -1);
+    }
+
+  g_string_free (a->out, TRUE);
+  g_free (a);
+}
+
+static void
+stop_icon_action (YadIconAction * a)
+{
+  if (a->timeout)
+    g_source_remove (a->timeout);
+  a->timeout = 0;
+  if (a->pulse)
+    {
+      g_source_remove (a->pulse);
+      gtk_entry_set_progress_fraction (GTK_ENTRY (a->entry), 0.0);
+    }
+  a->pulse = 0;
+
+  if (a->ch)
+    {
+      g_source_remove (a->watch);
+      g_io_channel_unref (a->ch);
+      a->ch = NULL;
+    }
+
+  if (icon_action == a)
+    icon_action = NULL;
+}
+
+static void
+cancel_icon_action (YadIconAction * a)
+{
+  a->cancelled = TRUE;
+  if (a->running)
+    kill (-a->pid, SIGTERM);
+  stop_icon_action (a);
+  finish_icon_action (a);
+}
+
+static gboolean
+icon_output_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
+{
+  YadIconAction *a = (YadIconAction *) data;
+  GIOStatus status;
+  gchar buf[1024];
+  gsize len;
+
+  do
+    {
+      status = g_io_channel_read_chars (ch, buf, sizeof (buf), &len, NULL);
+      if (len)
+        g_string_append_len (a->out, buf, len);
+    }
+  while (status == G_IO_STATUS_NORMAL);
+
+  if (status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR)
+    {
+      /* watch is removed by returning FALSE */
+      g_io_channel_unref (a->ch);
+      a->ch = NULL;
+      if (!a->running)
+        stop_icon_action (a);
+      finish_icon_action (a);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+icon_exit_cb (GPid pid, gint status, gpointer data)
+{
+  YadIconAction *a = (YadIconAction *) data;
+
+  g_spawn_close_pid (pid);
+  a->status = status;
+  a->running = FALSE;
+  if (!a->ch)
+    stop_icon_action (a);
+  finish_icon_action (a);
+}
+
+static gboolean
+icon_timeout_cb (gpointer data)
+{
+  YadIconAction *a = (YadIconAction *) data;
+
+  g_printerr (_("Icon action timed out\n"));
+  a->timeout = 0;
+  cancel_icon_action (a);
+  return FALSE;
+}
+
+static gboolean
+icon_pulse_cb (gpointer data)
+{
+  YadIconAction *a = (YadIconAction *) data;
+
+  gtk_entry_progress_pulse (GTK_ENTRY (a->entry));
+  return TRUE;
+}
+
+static void
+icon_child_setup (gpointer data)
+{
+  /* own process group for killing all processes of the action */
+  setpgid (0, 0);
+}
+
+static void
+run_icon_action (GtkEntry * entry, gchar * cmd)
+{
+  YadIconAction *a;
+  gchar *argv[4];
+  GPid pid;
+  gint out;
+  GError *err = NULL;
+
+  /* run through the shell as popen does */
+  argv[0] = "/bin/sh";
+  argv[1] = "-c";
+  argv[2] = cmd;
+  argv[3] = NULL;
+
+  if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                                 icon_child_setup, NULL, &pid, NULL, &out, NULL, &err))
+    {
+      g_printerr (_("Unable to run command %s: %s\n"), cmd, err->message);
+      g_error_free (err);
+      return;
+    }
+
+  a = g_new0 (YadIconAction, 1);
+  a->entry = GTK_WIDGET (entry);
+  a->pid = pid;
+  a->running = TRUE;
+  a->out = g_string_new (NULL);
+
+  a->ch = g_io_channel_unix_new (out);
+  g_io_channel_set_encoding (a->ch, NULL, NULL);
+  g_io_channel_set_flags (a->ch, G_IO_FLAG_NONBLOCK, NULL);
+  g_io_channel_set_close_on_unref (a->ch, TRUE);
+  a->watch = g_io_add_watch (a->ch, G_IO_IN | G_IO_HUP | G_IO_ERR, icon_output_cb, a);
+
+  g_child_watch_add (a->pid, icon_exit_cb, a);
+
+  if (options.entry_data.icon_timeout)
+    a->timeout = g_timeout_add_seconds (options.entry_data.icon_timeout, icon_timeout_cb, a);
+
+  /* show that action is running */
+  gtk_entry_set_progress_pulse_step (entry, 0.2);
+  a->pulse = g_timeout_add (100, icon_pulse_cb, a);
+
+  icon_action = a;
+}
+
 static void
 icon_cb (GtkEntry * entry, GtkEntryIconPosition pos, GdkEventButton * event, gpointer data)
 {
@@ -54,6 +246,13 @@ icon_cb (GtkEntry * entry, GtkEntryIconPosition pos, GdkEventButton * event, gpo
     {
       gchar *cmd = NULL;
 
+      /* second click cancels running action */
+      if (icon_action)
+        {
+          cancel_icon_action (icon_action);
+          return;
+        }
+
       switch (pos)
         {
         case GTK_ENTRY_ICON_PRIMARY:
@@ -65,51 +264,37 @@ icon_cb (GtkEntry * entry, GtkEntryIconPosition pos, GdkEventButton * event, gpo
         }
 
       if (cmd)
+        run_icon_action (entry, cmd);
+      else
         {
-          FILE *pf;
-          gchar buf[1024];
-          GString *str;
-
-          str = g_string_new ("");
-          pf = popen (cmd, "r");
-          while (fgets (buf, sizeof (buf), pf))
-            g_string_append (str, buf);
-          if (pclose (pf) == 0)
-            {
-              if (str->str[str->len - 1] == '\n')
-                str->str[str->len - 1] = '\0';
-              gtk_entry_set_text (GTK_ENTRY (entry), str->str);
-            }
-          g_string_free (str, TRUE);
+          gtk_entry_set_text (GTK_ENTRY (entry), "");
+          /* move cursor to the end of text */
+          gtk_editable_set_position (GTK_EDITABLE (entry), -1);
         }
-      else
-        gtk_entry_set_text (GTK_ENTRY (entry), "");
-
-      /* move cursor to the end of text */
-      gtk_editable_set_position (GTK_EDITABLE (entry), -1);
     }
 }
 
-static GtkTreeModel *
-create_completion_model (void)
+static gchar *
+get_entry_text (void)
 {
-  GtkListStore *store;
-  GtkTreeIter iter;
-  gint i = 0;
-
-  store = gtk_list_store_new (1, G_TYPE_STRING);
-
-  if (options.extra_data)
-    {
-      while (options.extra_data[i] != NULL)
-        {
-          gtk_list_store_append (store, &iter);
-          gtk_list_store_set (store, &iter, 0, options.extra_data[i], -1);
-          i++;
-        }
-    }
+  if (options.entry_data.numeric)
+    return g_strdup_printf ("%lf", gtk_spin_button_get_value (GTK_SPIN_BUTTON (entry)));
+  else if (is_combo)
+#if GTK_CHECK_VERSION(2,24,0)
+    return gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (entry));
+#else
+    return gtk_combo_box_get_active_text (GTK_COMBO_BOX (entry));
+#endif
+  else
+    return g_strdup (gtk_entry_get_text (GTK_ENTRY (entry)));
+}
 
-  return GTK_TREE_MODEL (store);
+static void
+print_changes_cb (GtkWidget * w, gpointer data)
+{
+  gchar *val = get_entry_text ();
+  print_change (0, val ? val : "");
+  g_free (val);
 }
 
 GtkWidget *
@@ -189,7 +374,7 @@ entry_create_widget (GtkWidget * dlg)
           gtk_spin_button_set_value (GTK_SPIN_BUTTON (c), val);
         }
     }
-  else if (!options.entry_data.completion && options.extra_data && *options.extra_data)
+  else if (!options.entry_data.completion && !options.entry_data.completion_cmd && options.extra_data && *options.extra_data)
     {
       gint active, i;
 
@@ -269,21 +454,10 @@ entry_create_widget (GtkWidget * dlg)
       if (options.entry_data.hide_text)
         g_object_set (G_OBJECT (entry), "visibility", FALSE, NULL);
 
-      if (options.entry_data.completion)
-        {
-          GtkEntryCompletion *completion;
-          GtkTreeModel *completion_model;
-
-          completion = gtk_entry_completion_new ();
-          gtk_entry_set_completion (GTK_ENTRY (entry), completion);
-
-          completion_model = create_completion_model ();
-          gtk_entry_completion_set_model (completion, completion_model);
-          g_object_unref (completion_model);
-
-          gtk_entry_completion_set_text_column (completion, 0);
-          g_object_unref (completion);
-        }
+      if (options.entry_data.completion_cmd)
+        set_completion_command (entry, options.entry_data.completion_cmd);
+      else if (options.entry_data.completion)
+        set_completion (entry, g_strdupv (options.extra_data), options.entry_data.fuzzy);
 
       if (options.entry_data.licon)
         {
@@ -312,6 +486,9 @@ entry_create_widget (GtkWidget * dlg)
   if (options.entry_data.licon || options.entry_data.ricon)
     g_signal_connect (G_OBJECT (entry), "icon-press", G_CALLBACK (icon_cb), NULL);
 
+  if (options.common_data.print_changes)
+    g_signal_connect (G_OBJECT (entry), "changed", G_CALLBACK (print_changes_cb), NULL);
+
   gtk_box_pack_start (GTK_BOX (w), c, TRUE, TRUE, 1);
 
   return w;
@@ -320,14 +497,7 @@ entry_create_widget (GtkWidget * dlg)
 void
 entry_print_result (void)
 {
-  if (options.entry_data.numeric)
-    g_print ("%lf\n", gtk_spin_button_get_value (GTK_SPIN_BUTTON (entry)));
-  else if (is_combo)
-#if GTK_CHECK_VERSION(2,24,0)
-    g_print ("%s\n", gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (entry)));
-#else
-    g_print ("%s\n", gtk_combo_box_get_active_text (GTK_COMBO_BOX (entry)));
-#endif
-  else
-    g_print ("%s\n", gtk_entry_get_text (GTK_ENTRY (entry)));
+  gchar *val = get_entry_text ();
+  g_print ("%s\n", val);
+  g_free (val);
 }
@@ -18,18 +18,335 @@
  */
 
 #include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <signal.h>
 #include <glib/gprintf.h>
 
 #include "yad.h"
 
 #include "calendar.xpm"
 
-static GSList *fields = NULL;
+/* field registry. widgets and descriptions are indexed by number, numbers are hashed by names */
+static GPtrArray *fields = NULL;
+static GPtrArray *field_info = NULL;
+static GHashTable *field_names = NULL;
 static guint n_fields;
 
-static void button_clicked_cb (GtkButton * b, gchar * action);
+/* running @-action of the button */
+typedef struct {
+  GtkWidget *btn;
+  GtkWidget *label;
+  gchar *tooltip;
+  GPid pid;
+  GIOChannel *ch;
+  guint watch;
+  gboolean running;
+} YadAction;
+
+/* all running @-actions */
+static GPtrArray *actions = NULL;
+
+static void button_clicked_cb (GtkButton * b, gpointer data);
+
+/* find field number by its id or label. mnemonic underscores of label may be omitted */
+static gint
+field_by_name (const gchar * name)
+{
+  gpointer n;
+
+  if (field_names && g_hash_table_lookup_extended (field_names, name, NULL, &n))
+    return GPOINTER_TO_INT (n);
+
+  return -1;
+}
+
+static void
+register_names (void)
+{
+  guint i;
+
+  field_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* explicit ids take precedence over labels */
+  for (i = 0; i < n_fields; i++)
+    {
+      YadField *fld = g_ptr_array_index (field_info, i);
+
+      if (fld->id && !g_hash_table_contains (field_names, fld->id))
+        g_hash_table_insert (field_names, g_strdup (fld->id), GINT_TO_POINTER (i));
+    }
+  for (i = 0; i < n_fields; i++)
+    {
+      YadField *fld = g_ptr_array_index (field_info, i);
+      gchar **parts, *nm;
+
+      if (!fld->name || !fld->name[0])
+        continue;
+
+      if (!g_hash_table_contains (field_names, fld->name))
+        g_hash_table_insert (field_names, g_strdup (fld->name), GINT_TO_POINTER (i));
+
+      parts = g_strsplit (fld->name, "_", -1);
+      nm = g_strjoinv (NULL, parts);
+      g_strfreev (parts);
+      if (!g_hash_table_contains (field_names, nm))
+        g_hash_table_insert (field_names, nm, GINT_TO_POINTER (i));
+      else
+        g_free (nm);
+    }
+}
+
+/* with --large-lists, lists with more items are shown as entries with indexed completion */
+#define FORM_LARGE_LIST 1000
+
+/* combo fields with large lists are entries. combo-box entry returns only its items */
+static gchar *
+get_combo_text (GtkWidget * w)
+{
+  if (GTK_IS_ENTRY (w))
+    {
+      if (g_object_get_data (G_OBJECT (w), "yad-items"))
+        return g_strdup ((gchar *) g_object_get_data (G_OBJECT (w), "yad-value"));
+      return g_strdup (gtk_entry_get_text (GTK_ENTRY (w)));
+    }
+#if GTK_CHECK_VERSION(2,24,0)
+  return gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (w));
+#else
+  return gtk_combo_box_get_active_text (GTK_COMBO_BOX (w));
+#endif
+}
+
+/* initial value <FILE or |COMMAND of combo fields. file and command output contain one item per line */
+static gboolean
+is_list_source (const gchar * value)
+{
+  return value[0] == '<' || value[0] == '|';
+}
+
+static gboolean
+is_large_list (const gchar * value)
+{
+  const gchar *p = value;
+  guint n = 0;
+  gsize sl = strlen (options.common_data.item_separator);
+
+  if (is_list_source (value))
+    return TRUE;
+
+  while (sl && (p = strstr (p, options.common_data.item_separator)) != NULL)
+    {
+      if (++n >= FORM_LARGE_LIST)
+        return TRUE;
+      p += sl;
+    }
+
+  return FALSE;
+}
+
+/* item started from ^ is the default one */
+static void
+find_default_item (gchar ** items, gint * def)
+{
+  gint i;
+
+  *def = -1;
+  for (i = 0; items[i]; i++)
+    {
+      if (items[i][0] == '^')
+        {
+          memmove (items[i], items[i] + 1, strlen (items[i]));
+          *def = i;
+        }
+    }
+}
+
+/* get unescaped list items */
+static gchar **
+get_list_items (gchar * value, gint * def)
+{
+  gchar **items;
+  gint i;
+
+  items = g_strsplit (value, options.common_data.item_separator, -1);
+  for (i = 0; items[i]; i++)
+    {
+      gchar *buf = g_strcompress (items[i]);
+      g_free (items[i]);
+      items[i] = buf;
+    }
+  find_default_item (items, def);
+
+  return items;
+}
+
+/* set items of combo or completion field. items are owned by the field after call */
+static void
+set_list_items (GtkWidget * w, gchar ** items, gint def)
+{
+  gint i;
+
+  if (GTK_IS_ENTRY (w))
+    {
+      if (g_object_get_data (G_OBJECT (w), "yad-strict"))
+        {
+          GHashTable *set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+          for (i = 0; items[i]; i++)
+            g_hash_table_add (set, g_strdup (items[i]));
+          g_object_set_data_full (G_OBJECT (w), "yad-items", set, (GDestroyNotify) g_hash_table_destroy);
+
+          /* like a combo-box, select the first item by default */
+          if (def < 0 && items[0])
+            def = 0;
+          g_object_set_data_full (G_OBJECT (w), "yad-value", def >= 0 ? g_strdup (items[def]) : NULL, g_free);
+          gtk_entry_set_text (GTK_ENTRY (w), def >= 0 ? items[def] : "");
+        }
+      else if (def >= 0)
+        gtk_entry_set_text (GTK_ENTRY (w), items[def]);
+      set_completion (w, items, FALSE);
+    }
+  else
+    {
+      GtkTreeModel *m;
+
+      /* fill detached model at once */
+      m = g_object_ref (gtk_combo_box_get_model (GTK_COMBO_BOX (w)));
+      gtk_combo_box_set_model (GTK_COMBO_BOX (w), NULL);
+      gtk_list_store_clear (GTK_LIST_STORE (m));
+      for (i = 0; items[i]; i++)
+        gtk_list_store_insert_with_values (GTK_LIST_STORE (m), NULL, -1, 0, items[i], -1);
+      gtk_combo_box_set_model (GTK_COMBO_BOX (w), m);
+      g_object_unref (m);
+
+      gtk_combo_box_set_active (GTK_COMBO_BOX (w), MAX (def, 0));
+      g_strfreev (items);
+    }
+}
+
+static void
+set_list_index (GtkWidget * w, gchar * value)
+{
+  gchar **items;
+  gint def;
+
+  items = get_list_items (value, &def);
+  set_list_items (w, items, def);
+}
+
+/* items from file or command, read in background */
+typedef struct {
+  GtkWidget *w;
+  gchar *src;
+  GString *data;
+} YadListSource;
+
+static gboolean
+list_source_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
+{
+  YadListSource *ls = (YadListSource *) data;
+  gchar buf[65536];
+  gchar **items;
+  gsize n = 0;
+  gint i, def;
+  GIOStatus status;
+  GError *err = NULL;
+
+  /* one block per call, so the dialog keeps responding while large file is read */
+  status = g_io_channel_read_chars (ch, buf, sizeof (buf), &n, &err);
+  g_string_append_len (ls->data, buf, n);
+  if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+    return TRUE;
+
+  if (err)
+    {
+      g_printerr (_("Unable to get list items from %s: %s\n"), ls->src, err->message);
+      g_error_free (err);
+    }
+
+  items = g_strsplit (ls->data->str, "\n", -1);
+  /* remove empty item after the last newline */
+  i = g_strv_length (items);
+  if (i > 0 && !items[i - 1][0])
+    {
+      g_free (items[i - 1]);
+      items[i - 1] = NULL;
+    }
+  find_default_item (items, &def);
+  set_list_items (ls->w, items, def);
+
+  g_object_unref (ls->w);
+  g_free (ls->src);
+  g_string_free (ls->data, TRUE);
+  g_free (ls);
+
+  return FALSE;
+}
+
+/* start reading items of field from <FILE or |COMMAND. used only for initial values from command line */
+static void
+load_list_source (GtkWidget * w, gchar * value)
+{
+  YadListSource *ls;
+  GIOChannel *ch = NULL;
+  GError *err = NULL;
+
+  if (value[0] == '<')
+    ch = g_io_channel_new_file (value + 1, "r", &err);
+  else
+    {
+      gchar **argv;
+      gint out;
+
+      if (g_shell_parse_argv (value + 1, NULL, &argv, &err))
+        {
+          if (g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, NULL, &out, NULL, &err))
+            {
+              ch = g_io_channel_unix_new (out);
+              g_io_channel_set_close_on_unref (ch, TRUE);
+              g_io_channel_set_flags (ch, G_IO_FLAG_NONBLOCK, NULL);
+            }
+          g_strfreev (argv);
+        }
+    }
+
+  if (!ch)
+    {
+      g_printerr (_("Unable to get list items from %s: %s\n"), value + 1, err->message);
+      g_error_free (err);
+      return;
+    }
+  g_io_channel_set_encoding (ch, NULL, NULL);
+
+  ls = g_new0 (YadListSource, 1);
+  ls->w = g_object_ref (w);
+  ls->src = g_strdup (value + 1);
+  ls->data = g_string_new (NULL);
+  g_io_add_watch (ch, G_IO_IN | G_IO_HUP | G_IO_ERR, list_source_cb, ls);
+  g_io_channel_unref (ch);
+}
+
+/* parse line in format N:value or NAME:value. returns field number or -1 */
+static gint
+parse_field_line (gchar * line, gchar ** value)
+{
+  gchar *sep, *end;
+  gint fn;
+
+  sep = strchr (line, ':');
+  if (!sep)
+    return -1;
+
+  *sep = '\0';
+  fn = g_ascii_strtoll (line, &end, 10) - 1;
+  if (*end || end == line)
+    fn = field_by_name (line);
+  *value = sep + 1;
+
+  return (fn >= 0 && fn < (gint) n_fields) ? fn : -1;
+}
 
-/* expand %N in command to fields values */
+/* expand %N and %{NAME} in command to fields values */
 static GString *
 expand_action (gchar * cmd)
 {
@@ -42,24 +359,44 @@ expand_action (gchar * cmd)
       if (cmd[i] == '%')
         {
           i++;
-          if (g_ascii_isdigit (cmd[i]))
+          if (g_ascii_isdigit (cmd[i]) || cmd[i] == '{')
             {
               YadField *fld;
               gchar *buf;
               guint num, j = i;
 
-              /* get field num */
-              while (g_ascii_isdigit (cmd[j]))
-                j++;
-              buf = g_strndup (cmd + i, j - i);
-              num = g_ascii_strtoll (buf, NULL, 10);
-              g_free (buf);
-              if (num > 0 && num <= n_fields)
-                num--;
+              if (cmd[i] == '{')
+                {
+                  /* get field by name */
+                  gchar *end = strchr (cmd + i, '}');
+                  gint fn = -1;
+
+                  if (end)
+                    {
+                      buf = g_strndup (cmd + i + 1, end - cmd - i - 1);
+                      fn = field_by_name (buf);
+                      g_free (buf);
+                    }
+                  if (fn < 0)
+                    continue;
+                  num = fn;
+                  j = end - cmd + 1;
+                }
               else
-                continue;
+                {
+                  /* get field num */
+                  while (g_ascii_isdigit (cmd[j]))
+                    j++;
+                  buf = g_strndup (cmd + i, j - i);
+                  num = g_ascii_strtoll (buf, NULL, 10);
+                  g_free (buf);
+                  if (num > 0 && num <= n_fields)
+                    num--;
+                  else
+                    continue;
+                }
               /* get field value */
-              fld = g_slist_nth_data (options.form_data.fields, num);
+              fld = g_ptr_array_index (field_info, num);
               switch (fld->type)
                 {
                 case YAD_FIELD_SIMPLE:
@@ -71,45 +408,40 @@ expand_action (gchar * cmd)
                 case YAD_FIELD_MFILE:
                 case YAD_FIELD_MDIR:
                 case YAD_FIELD_DATE:
-                  g_string_append (xcmd, gtk_entry_get_text (GTK_ENTRY (g_slist_nth_data (fields, num))));
+                  g_string_append (xcmd, gtk_entry_get_text (GTK_ENTRY (g_ptr_array_index (fields, num))));
                   break;
                 case YAD_FIELD_NUM:
                   g_string_append_printf (xcmd, "%f", gtk_spin_button_get_value
-                                          (GTK_SPIN_BUTTON (g_slist_nth_data (fields, num))));
+                                          (GTK_SPIN_BUTTON (g_ptr_array_index (fields, num))));
                   break;
                 case YAD_FIELD_CHECK:
                   g_string_append (xcmd, gtk_toggle_button_get_active
-                                   (GTK_TOGGLE_BUTTON (g_slist_nth_data (fields, num))) ? "TRUE" : "FALSE");
+                                   (GTK_TOGGLE_BUTTON (g_ptr_array_index (fields, num))) ? "TRUE" : "FALSE");
                   break;
                 case YAD_FIELD_COMBO:
                 case YAD_FIELD_COMBO_ENTRY:
-                  g_string_append (xcmd,
-#if GTK_CHECK_VERSION(2,24,0)
-                                   gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT
-                                                                       (g_slist_nth_data (fields, num)))
-#else
-                                   gtk_combo_box_get_active_text (GTK_COMBO_BOX (g_slist_nth_data (fields, num)))
-#endif
-                    );
+                  buf = get_combo_text (g_ptr_array_index (fields, num));
+                  g_string_append (xcmd, buf ? buf : "");
+                  g_free (buf);
                   break;
                 case YAD_FIELD_SCALE:
                   g_string_append_printf (xcmd, "%d", (gint) gtk_range_get_value
-                                          (GTK_RANGE (g_slist_nth_data (fields, num))));
+                                          (GTK_RANGE (g_ptr_array_index (fields, num))));
                   break;
                 case YAD_FIELD_FILE:
                 case YAD_FIELD_DIR:
                   g_string_append (xcmd,
-                                   gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (g_slist_nth_data (fields, num))));
+                                   gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (g_ptr_array_index (fields, num))));
                   break;
                 case YAD_FIELD_FONT:
                   g_string_append (xcmd,
-                                   gtk_font_button_get_font_name (GTK_FONT_BUTTON (g_slist_nth_data (fields, num))));
+                                   gtk_font_button_get_font_name (GTK_FONT_BUTTON (g_ptr_array_index (fields, num))));
                   break;
                 case YAD_FIELD_COLOR:
                   {
                     GdkColor c;
 
-                    gtk_color_button_get_color (GTK_COLOR_BUTTON (g_slist_nth_data (fields, num)), &c);
+                    gtk_color_button_get_color (GTK_COLOR_BUTTON (g_ptr_array_index (fields, num)), &c);
                     buf = gdk_color_to_string (&c);
                     g_free (buf);
                     break;
@@ -120,7 +452,7 @@ expand_action (gchar * cmd)
                     GtkTextBuffer *tb;
                     GtkTextIter b, e;
 
-                    tb = gtk_text_view_get_buffer (GTK_TEXT_VIEW (g_slist_nth_data (fields, num)));
+                    tb = gtk_text_view_get_buffer (GTK_TEXT_VIEW (g_ptr_array_index (fields, num)));
                     gtk_text_buffer_get_bounds (tb, &b, &e);
                     buf = gtk_text_buffer_get_text (tb, &b, &e, FALSE);
                     txt = escape_str (buf);
@@ -154,9 +486,9 @@ set_field_value (guint num, gchar * value)
 {
   GtkWidget *w;
   gchar **s;
-  YadField *fld = g_slist_nth_data (options.form_data.fields, num);
+  YadField *fld = g_ptr_array_index (field_info, num);
 
-  w = GTK_WIDGET (g_slist_nth_data (fields, num));
+  w = GTK_WIDGET (g_ptr_array_index (fields, num));
   if (g_ascii_strcasecmp (value, "@disabled@") == 0)
     {
       gtk_widget_set_sensitive (w, FALSE);
@@ -184,7 +516,7 @@ set_field_value (guint num, gchar * value)
       if (s[0])
         {
           gdouble val = g_ascii_strtod (s[0], NULL);
-          w = g_slist_nth_data (fields, num);
+          w = g_ptr_array_index (fields, num);
           if (s[1])
             {
               gdouble min, max;
@@ -220,70 +552,13 @@ set_field_value (guint num, gchar * value)
       break;
 
     case YAD_FIELD_COMPLETE:
-      {
-        GtkEntryCompletion *c;
-        GtkTreeModel *m;
-        GtkTreeIter it;
-        gint i = 0, def = -1;
-
-        c = gtk_entry_get_completion (GTK_ENTRY (w));
-        m = gtk_entry_completion_get_model (GTK_ENTRY_COMPLETION (c));
-        gtk_list_store_clear (GTK_LIST_STORE (m));
-
-        s = g_strsplit (value, options.common_data.item_separator, -1);
-        while (s[i])
-          {
-            gtk_list_store_append (GTK_LIST_STORE (m), &it);
-            if (s[i][0] == '^')
-              {
-                gtk_list_store_set (GTK_LIST_STORE (m), &it, 0, g_strcompress (s[i] + 1), -1);
-                def = i;
-              }
-            else
-              gtk_list_store_set (GTK_LIST_STORE (m), &it, 0, g_strcompress (s[i]), -1);
-
-            i++;
-          }
-        if (def >= 0)
-          gtk_entry_set_text (GTK_ENTRY (w), s[def]);
-        g_strfreev (s);
-        break;
-      }
+      set_list_index (w, value);
+      break;
 
     case YAD_FIELD_COMBO:
     case YAD_FIELD_COMBO_ENTRY:
-      {
-        GtkTreeModel *m;
-        gint i = 0, def = 0;
-
-        /* cleanup previous values */
-        m = gtk_combo_box_get_model (GTK_COMBO_BOX (w));
-        gtk_list_store_clear (GTK_LIST_STORE (m));
-
-        s = g_strsplit (value, options.common_data.item_separator, -1);
-        while (s[i])
-          {
-            gchar *buf;
-
-            if (s[i][0] == '^')
-              {
-                buf = g_strcompress (s[i] + 1);
-                def = i;
-              }
-            else
-              buf = g_strcompress (s[i]);
-#if GTK_CHECK_VERSION(2,24,0)
-            gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (w), buf);
-#else
-            gtk_combo_box_append_text (GTK_COMBO_BOX (w), buf);
-#endif
-            g_free (buf);
-            i++;
-          }
-        gtk_combo_box_set_active (GTK_COMBO_BOX (w), def);
-        g_strfreev (s);
-        break;
-      }
+      set_list_index (w, value);
+      break;
 
     case YAD_FIELD_DIR:
       gtk_file_chooser_set_current_folder (GTK_FILE_CHOOSER (w), value);
@@ -310,7 +585,8 @@ set_field_value (guint num, gchar * value)
 
     case YAD_FIELD_BUTTON:
     case YAD_FIELD_FULL_BUTTON:
-      g_signal_connect (G_OBJECT (w), "clicked", G_CALLBACK (button_clicked_cb), value);
+      /* value may be a part of input buffer, so button keeps its own copy */
+      g_object_set_data_full (G_OBJECT (w), "yad-command", g_strdup (value), g_free);
       break;
 
     case YAD_FIELD_TEXT:
@@ -327,43 +603,211 @@ set_field_value (guint num, gchar * value)
 }
 
 static void
-button_clicked_cb (GtkButton * b, gchar * action)
+apply_field_line (gchar * line)
+{
+  gchar *value;
+  gint fn = parse_field_line (line, &value);
+
+  if (fn >= 0)
+    set_field_value (fn, value);
+}
+
+static void
+set_button_busy (YadAction * a, gboolean busy)
+{
+  if (busy)
+    {
+      GtkWidget *box, *sp;
+
+      /* show spinner near the original label */
+      a->label = g_object_ref (gtk_bin_get_child (GTK_BIN (a->btn)));
+      gtk_container_remove (GTK_CONTAINER (a->btn), a->label);
+#if !GTK_CHECK_VERSION(3,0,0)
+      box = gtk_hbox_new (FALSE, 2);
+#else
+      box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 2);
+#endif
+      sp = gtk_spinner_new ();
+      gtk_spinner_start (GTK_SPINNER (sp));
+      gtk_box_pack_start (GTK_BOX (box), sp, FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (box), a->label, TRUE, TRUE, 0);
+      gtk_widget_show_all (box);
+      gtk_container_add (GTK_CONTAINER (a->btn), box);
+      a->tooltip = gtk_widget_get_tooltip_text (a->btn);
+      gtk_widget_set_tooltip_text (a->btn, _("Click to cancel"));
+      g_object_set_data (G_OBJECT (a->btn), "yad-action", a);
+    }
+  else
+    {
+      GtkWidget *box = gtk_bin_get_child (GTK_BIN (a->btn));
+
+      gtk_container_remove (GTK_CONTAINER (box), a->label);
+      gtk_container_remove (GTK_CONTAINER (a->btn), box);
+      gtk_container_add (GTK_CONTAINER (a->btn), a->label);
+      g_object_unref (a->label);
+      gtk_widget_set_tooltip_text (a->btn, a->tooltip);
+      g_free (a->tooltip);
+      a->tooltip = NULL;
+      g_object_set_data (G_OBJECT (a->btn), "yad-action", NULL);
+    }
+}
+
+static void
+free_action (YadAction * a)
+{
+  g_ptr_array_remove (actions, a);
+  g_free (a);
+}
+
+/* actions still running when dialog exits are not needed anymore */
+static void
+kill_actions (void)
+{
+  guint i;
+
+  for (i = 0; i < actions->len; i++)
+    {
+      YadAction *a = g_ptr_array_index (actions, i);
+
+      if (a->pid)
+        kill (-a->pid, SIGTERM);
+    }
+}
+
+static void
+stop_reading (YadAction * a)
+{
+  g_source_remove (a->watch);
+  g_io_channel_unref (a->ch);
+  a->ch = NULL;
+  set_button_busy (a, FALSE);
+}
+
+static gboolean
+action_output_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
 {
-  static gchar *newline = NULL;
+  YadAction *a = (YadAction *) data;
+  GIOStatus status;
+
+  /* apply every complete line as soon as it arrives */
+  do
+    {
+      gchar *line = NULL;
+      gsize len, term;
+
+      status = g_io_channel_read_line (ch, &line, &len, &term, NULL);
+      if (line)
+        {
+          line[term] = '\0';
+          apply_field_line (line);
+          g_free (line);
+        }
+    }
+  while (status == G_IO_STATUS_NORMAL);
+
+  if (status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR)
+    {
+      /* watch is removed by returning FALSE */
+      a->watch = 0;
+      g_io_channel_unref (a->ch);
+      a->ch = NULL;
+      set_button_busy (a, FALSE);
+      if (!a->running)
+        free_action (a);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+action_exit_cb (GPid pid, gint status, gpointer data)
+{
+  YadAction *a = (YadAction *) data;
+
+  g_spawn_close_pid (pid);
+  a->pid = 0;
+  a->running = FALSE;
+  if (!a->ch)
+    free_action (a);
+}
+
+static void
+action_child_setup (gpointer data)
+{
+  /* own process group for killing all processes of the action */
+  setpgid (0, 0);
+}
+
+static void
+run_action (GtkButton * b, gchar * action)
+{
+  YadAction *a;
+  GString *cmd;
+  gchar **argv = NULL;
+  GPid pid;
+  gint out;
+  GError *err = NULL;
+
+  cmd = expand_action (action);
+  if (!g_shell_parse_argv (cmd->str, NULL, &argv, &err) ||
+      !g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                 action_child_setup, NULL, &pid, NULL, &out, NULL, &err))
+    {
+      g_printerr (_("Unable to run command %s: %s\n"), cmd->str, err->message);
+      g_error_free (err);
+      g_strfreev (argv);
+      g_string_free (cmd, TRUE);
+      return;
+    }
+  g_strfreev (argv);
+  g_string_free (cmd, TRUE);
+
+  a = g_new0 (YadAction, 1);
+  a->btn = GTK_WIDGET (b);
+  a->pid = pid;
+  a->running = TRUE;
+
+  if (!actions)
+    {
+      actions = g_ptr_array_new ();
+      atexit (kill_actions);
+    }
+  g_ptr_array_add (actions, a);
+
+  a->ch = g_io_channel_unix_new (out);
+  g_io_channel_set_encoding (a->ch, NULL, NULL);
+  g_io_channel_set_flags (a->ch, G_IO_FLAG_NONBLOCK, NULL);
+  g_io_channel_set_close_on_unref (a->ch, TRUE);
+  a->watch = g_io_add_watch (a->ch, G_IO_IN | G_IO_HUP | G_IO_ERR, action_output_cb, a);
+
+  g_child_watch_add (a->pid, action_exit_cb, a);
+
+  set_button_busy (a, TRUE);
+}
 
-  if (!newline)
-    newline = g_strcompress ("\n");
+static void
+button_clicked_cb (GtkButton * b, gpointer data)
+{
+  gchar *action = g_object_get_data (G_OBJECT (b), "yad-command");
 
   if (action && action[0])
     {
       if (action[0] == '@')
         {
-          gchar *data;
-          gint exit = 1;
-          GString *cmd = expand_action (action + 1);
-          g_spawn_command_line_sync (cmd->str, &data, NULL, &exit, NULL);
-          if (exit == 0)
-            {
-              guint i = 0;
-              gchar **lines = g_strsplit (data, "\n", 0);
-              while (lines[i] && lines[i][0])
-                {
-                  gint fn;
-                  gchar **ln;
-
-                  if (!lines[i][0])
-                    continue;
+          YadAction *a = g_object_get_data (G_OBJECT (b), "yad-action");
 
-                  ln = g_strsplit (lines[i], ":", 2);
-                  fn = g_ascii_strtoll (ln[0], NULL, 10);
-                  if (fn && ln[1])
-                    set_field_value (fn - 1, ln[1]);
-                  g_strfreev (ln);
-                  i++;
-                }
+          if (a)
+            {
+              /* second click cancels running action */
+              if (a->pid)
+                kill (-a->pid, SIGTERM);
+              stop_reading (a);
+              if (!a->running)
+                free_action (a);
             }
-          g_free (data);
-          g_string_free (cmd, TRUE);
+          else
+            run_action (b, action + 1);
         }
       else
         {
@@ -581,6 +1025,280 @@ select_date_cb (GtkEntry * entry, GtkEntryIconPosition pos, GdkEventButton * eve
     }
 }
 
+/* fields are updated by lines N:VALUE or NAME:VALUE, so only the last line for a field is needed */
+static gchar *
+record_key (gchar * line)
+{
+  gchar *p = strchr (line, ':');
+
+  return p ? g_strndup (line, p - line) : NULL;
+}
+
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
+{
+  gchar **values;
+  guint i;
+
+  /* only the latest value of each field is applied */
+  values = g_new0 (gchar *, n_fields);
+  for (i = 0; i < n_lines; i++)
+    {
+      gchar *value;
+      gint fn = parse_field_line (lines[i], &value);
+
+      if (fn >= 0)
+        values[fn] = value;
+    }
+
+  for (i = 0; i < n_fields; i++)
+    {
+      if (values[i])
+        set_field_value (i, values[i]);
+    }
+  g_free (values);
+}
+
+static void
+add_completion (GtkWidget * e)
+{
+  GtkEntryCompletion *c = gtk_entry_completion_new ();
+  GtkListStore *m = gtk_list_store_new (1, G_TYPE_STRING);
+
+  gtk_entry_set_completion (GTK_ENTRY (e), c);
+  gtk_entry_completion_set_model (c, GTK_TREE_MODEL (m));
+  gtk_entry_completion_set_text_column (c, 0);
+
+  g_object_unref (m);
+  g_object_unref (c);
+}
+
+/* check if initial value of the field is a large list */
+static gboolean
+large_list (guint fn)
+{
+  static guint n_extra = G_MAXUINT;
+
+  if (!options.form_data.large_lists || !options.extra_data)
+    return FALSE;
+  if (n_extra == G_MAXUINT)
+    n_extra = g_strv_length (options.extra_data);
+
+  return fn < n_extra && is_large_list (options.extra_data[fn]);
+}
+
+/* remember the last item selected in combo-box entry */
+static void
+strict_entry_changed_cb (GtkEntry * e, gpointer data)
+{
+  GHashTable *items = g_object_get_data (G_OBJECT (e), "yad-items");
+  const gchar *text = gtk_entry_get_text (e);
+
+  if (items && g_hash_table_contains (items, text))
+    g_object_set_data_full (G_OBJECT (e), "yad-value", g_strdup (text), g_free);
+}
+
+/* text which is not an item is replaced with the last selected item */
+static gboolean
+strict_entry_focus_out_cb (GtkWidget * w, GdkEventFocus * ev, gpointer data)
+{
+  gchar *val = g_object_get_data (G_OBJECT (w), "yad-value");
+
+  gtk_entry_set_text (GTK_ENTRY (w), val ? val : "");
+  return FALSE;
+}
+
+/* entry with completion for large list. strict entry accepts only items of the list */
+static GtkWidget *
+create_large_list (GtkWidget * dlg, gchar * name, gboolean strict)
+{
+  GtkWidget *e = gtk_entry_new ();
+
+  gtk_widget_set_name (e, name);
+  g_signal_connect (G_OBJECT (e), "activate", G_CALLBACK (form_activate_cb), dlg);
+  add_completion (e);
+
+  if (strict)
+    {
+      g_object_set_data (G_OBJECT (e), "yad-strict", GINT_TO_POINTER (TRUE));
+      g_signal_connect (G_OBJECT (e), "changed", G_CALLBACK (strict_entry_changed_cb), NULL);
+      g_signal_connect (G_OBJECT (e), "focus-out-event", G_CALLBACK (strict_entry_focus_out_cb), NULL);
+    }
+
+  return e;
+}
+
+static gchar *
+get_field_value (guint fn)
+{
+  gchar *val = NULL;
+  YadField *fld = g_ptr_array_index (field_info, fn);
+  GtkWidget *w = g_ptr_array_index (fields, fn);
+
+  switch (fld->type)
+    {
+    case YAD_FIELD_SIMPLE:
+    case YAD_FIELD_HIDDEN:
+    case YAD_FIELD_READ_ONLY:
+    case YAD_FIELD_COMPLETE:
+    case YAD_FIELD_MFILE:
+    case YAD_FIELD_MDIR:
+    case YAD_FIELD_FILE_SAVE:
+    case YAD_FIELD_DIR_CREATE:
+    case YAD_FIELD_DATE:
+      val = g_strdup (gtk_entry_get_text (GTK_ENTRY (w)));
+      break;
+    case YAD_FIELD_NUM:
+      val = g_strdup_printf ("%f", gtk_spin_button_get_value (GTK_SPIN_BUTTON (w)));
+      break;
+    case YAD_FIELD_CHECK:
+      val = g_strdup (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (w)) ? "TRUE" : "FALSE");
+      break;
+    case YAD_FIELD_COMBO:
+    case YAD_FIELD_COMBO_ENTRY:
+      val = get_combo_text (w);
+      break;
+    case YAD_FIELD_FILE:
+    case YAD_FIELD_DIR:
+      val = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (w));
+      break;
+    case YAD_FIELD_FONT:
+      val = g_strdup (gtk_font_button_get_font_name (GTK_FONT_BUTTON (w)));
+      break;
+    case YAD_FIELD_COLOR:
+      {
+        GdkColor c;
+
+        gtk_color_button_get_color (GTK_COLOR_BUTTON (w), &c);
+        val = gdk_color_to_string (&c);
+        break;
+      }
+    case YAD_FIELD_SCALE:
+      val = g_strdup_printf ("%d", (gint) gtk_range_get_value (GTK_RANGE (w)));
+      break;
+    case YAD_FIELD_TEXT:
+      {
+        gchar *txt;
+        GtkTextBuffer *tb;
+        GtkTextIter b, e;
+
+        tb = gtk_text_view_get_buffer (GTK_TEXT_VIEW (w));
+        gtk_text_buffer_get_bounds (tb, &b, &e);
+        txt = gtk_text_buffer_get_text (tb, &b, &e, FALSE);
+        val = escape_str (txt);
+        g_free (txt);
+        break;
+      }
+    default:
+      break;
+    }
+
+  return val ? val : g_strdup ("");
+}
+
+/* field value as it is printed in dialog output, with quotes and separator */
+static gchar *
+format_field (guint fn)
+{
+  gchar *val, *res;
+  YadField *fld = g_ptr_array_index (field_info, fn);
+
+  val = get_field_value (fn);
+  if (options.common_data.quoted_output)
+    {
+      switch (fld->type)
+        {
+        case YAD_FIELD_NUM:
+        case YAD_FIELD_CHECK:
+        case YAD_FIELD_FONT:
+        case YAD_FIELD_COLOR:
+        case YAD_FIELD_SCALE:
+        case YAD_FIELD_BUTTON:
+        case YAD_FIELD_FULL_BUTTON:
+        case YAD_FIELD_LABEL:
+          res = g_strdup_printf ("'%s'%s", val, options.common_data.separator);
+          break;
+        default:
+          {
+            gchar *buf = g_shell_quote (val);
+            res = g_strdup_printf ("%s%s", buf, options.common_data.separator);
+            g_free (buf);
+          }
+        }
+    }
+  else
+    res = g_strdup_printf ("%s%s", val, options.common_data.separator);
+  g_free (val);
+
+  return res;
+}
+
+static void
+field_changed_cb (GObject * obj, gpointer data)
+{
+  guint fn = GPOINTER_TO_UINT (data);
+  gchar *val = format_field (fn);
+
+  print_change (fn + 1, val);
+  g_free (val);
+}
+
+static void
+connect_changes (void)
+{
+  guint i;
+
+  for (i = 0; i < n_fields; i++)
+    {
+      YadField *fld = g_ptr_array_index (field_info, i);
+      GObject *obj = G_OBJECT (g_ptr_array_index (fields, i));
+      const gchar *signal = NULL;
+
+      switch (fld->type)
+        {
+        case YAD_FIELD_SIMPLE:
+        case YAD_FIELD_HIDDEN:
+        case YAD_FIELD_READ_ONLY:
+        case YAD_FIELD_COMPLETE:
+        case YAD_FIELD_MFILE:
+        case YAD_FIELD_MDIR:
+        case YAD_FIELD_FILE_SAVE:
+        case YAD_FIELD_DIR_CREATE:
+        case YAD_FIELD_DATE:
+        case YAD_FIELD_COMBO:
+        case YAD_FIELD_COMBO_ENTRY:
+          signal = "changed";
+          break;
+        case YAD_FIELD_NUM:
+        case YAD_FIELD_SCALE:
+          signal = "value-changed";
+          break;
+        case YAD_FIELD_CHECK:
+          signal = "toggled";
+          break;
+        case YAD_FIELD_FILE:
+        case YAD_FIELD_DIR:
+          signal = "selection-changed";
+          break;
+        case YAD_FIELD_FONT:
+          signal = "font-set";
+          break;
+        case YAD_FIELD_COLOR:
+          signal = "color-set";
+          break;
+        case YAD_FIELD_TEXT:
+          obj = G_OBJECT (gtk_text_view_get_buffer (GTK_TEXT_VIEW (obj)));
+          signal = "changed";
+          break;
+        default:
+          break;
+        }
+
+      if (signal)
+        g_signal_connect (obj, signal, G_CALLBACK (field_changed_cb), GUINT_TO_POINTER (i));
+    }
+}
+
 GtkWidget *
 form_create_widget (GtkWidget * dlg)
 {
@@ -592,9 +1310,15 @@ form_create_widget (GtkWidget * dlg)
     {
       GtkWidget *l, *e;
       GdkPixbuf *pb;
+      GSList *f;
       guint i, col, row, rows;
 
       n_fields = g_slist_length (options.form_data.fields);
+      fields = g_ptr_array_sized_new (n_fields);
+      field_info = g_ptr_array_sized_new (n_fields);
+      for (f = options.form_data.fields; f; f = f->next)
+        g_ptr_array_add (field_info, f->data);
+      register_names ();
 
       row = col = 0;
       rows = n_fields / options.form_data.columns;
@@ -634,7 +1358,7 @@ form_create_widget (GtkWidget * dlg)
       /* create form */
       for (i = 0; i < n_fields; i++)
         {
-          YadField *fld = g_slist_nth_data (options.form_data.fields, i);
+          YadField *fld = g_ptr_array_index (field_info, i);
 
           /* add field label */
           l = NULL;
@@ -679,20 +1403,10 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               if (fld->type == YAD_FIELD_COMPLETE)
-                {
-                  GtkEntryCompletion *c = gtk_entry_completion_new ();
-                  GtkListStore *m = gtk_list_store_new (1, G_TYPE_STRING);
-
-                  gtk_entry_set_completion (GTK_ENTRY (e), c);
-                  gtk_entry_completion_set_model (c, GTK_TREE_MODEL (m));
-                  gtk_entry_completion_set_text_column (c, 0);
-
-                  g_object_unref (m);
-                  g_object_unref (c);
-                }
+                add_completion (e);
 
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_NUM:
@@ -707,7 +1421,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_CHECK:
@@ -722,18 +1436,23 @@ form_create_widget (GtkWidget * dlg)
                 gtk_grid_attach (GTK_GRID (tbl), e, col * 2, row, 2, 1);
                 gtk_widget_set_hexpand (e, TRUE);
 #endif
-                fields = g_slist_append (fields, e);
+                g_ptr_array_add (fields, e);
                 g_free (buf);
               }
               break;
 
             case YAD_FIELD_COMBO:
+              if (large_list (i))
+                e = create_large_list (dlg, "yad-form-combo", TRUE);
+              else
+                {
 #if GTK_CHECK_VERSION(2,24,0)
-              e = gtk_combo_box_text_new ();
+                  e = gtk_combo_box_text_new ();
 #else
-              e = gtk_combo_box_new_text ();
+                  e = gtk_combo_box_new_text ();
 #endif
-              gtk_widget_set_name (e, "yad-form-combo");
+                  gtk_widget_set_name (e, "yad-form-combo");
+                }
 #if !GTK_CHECK_VERSION(3,0,0)
               gtk_table_attach (GTK_TABLE (tbl), e, 1 + col * 2, 2 + col * 2, row, row + 1,
                                 GTK_EXPAND | GTK_FILL, 0, 5, 5);
@@ -742,16 +1461,21 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_COMBO_ENTRY:
+              if (large_list (i))
+                e = create_large_list (dlg, "yad-form-edit-combo", FALSE);
+              else
+                {
 #if GTK_CHECK_VERSION(2,24,0)
-              e = gtk_combo_box_text_new_with_entry ();
+                  e = gtk_combo_box_text_new_with_entry ();
 #else
-              e = gtk_combo_box_entry_new_text ();
+                  e = gtk_combo_box_entry_new_text ();
 #endif
-              gtk_widget_set_name (e, "yad-form-edit-combo");
+                  gtk_widget_set_name (e, "yad-form-edit-combo");
+                }
 #if !GTK_CHECK_VERSION(3,0,0)
               gtk_table_attach (GTK_TABLE (tbl), e, 1 + col * 2, 2 + col * 2, row, row + 1,
                                 GTK_EXPAND | GTK_FILL, 0, 5, 5);
@@ -760,7 +1484,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_FILE:
@@ -788,7 +1512,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_DIR:
@@ -803,7 +1527,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_FONT:
@@ -817,7 +1541,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_COLOR:
@@ -831,7 +1555,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_MFILE:
@@ -849,7 +1573,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_FILE_SAVE:
@@ -867,7 +1591,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_DATE:
@@ -886,7 +1610,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_SCALE:
@@ -904,7 +1628,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_widget_set_hexpand (e, TRUE);
 #endif
               gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_BUTTON:
@@ -915,13 +1639,14 @@ form_create_widget (GtkWidget * dlg)
               gtk_button_set_alignment (GTK_BUTTON (e), 0.5, 0.5);
               if (fld->type == YAD_FIELD_BUTTON)
                 gtk_button_set_relief (GTK_BUTTON (e), GTK_RELIEF_NONE);
+              g_signal_connect (G_OBJECT (e), "clicked", G_CALLBACK (button_clicked_cb), NULL);
 #if !GTK_CHECK_VERSION(3,0,0)
               gtk_table_attach (GTK_TABLE (tbl), e, col * 2, 2 + col * 2, row, row + 1, GTK_EXPAND | GTK_FILL, 0, 5, 5);
 #else
               gtk_grid_attach (GTK_GRID (tbl), e, col * 2, row, 2, 1);
               gtk_widget_set_hexpand (e, TRUE);
 #endif
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_LABEL:
@@ -955,7 +1680,7 @@ form_create_widget (GtkWidget * dlg)
               gtk_grid_attach (GTK_GRID (tbl), e, col * 2, row, 2, 1);
               gtk_widget_set_hexpand (e, TRUE);
 #endif
-              fields = g_slist_append (fields, e);
+              g_ptr_array_add (fields, e);
               break;
 
             case YAD_FIELD_TEXT:
@@ -998,7 +1723,7 @@ form_create_widget (GtkWidget * dlg)
                 gtk_widget_set_vexpand (b, TRUE);
 #endif
                 gtk_label_set_mnemonic_widget (GTK_LABEL (l), e);
-                fields = g_slist_append (fields, e);
+                g_ptr_array_add (fields, e);
 
                 break;
               }
@@ -1019,10 +1744,24 @@ form_create_widget (GtkWidget * dlg)
           i = 0;
           while (options.extra_data[i] && i < n_fields)
             {
-              set_field_value (i, options.extra_data[i]);
+              YadField *fld = g_ptr_array_index (field_info, i);
+
+              /* items from file or command are allowed only in command line, never in updates */
+              if (options.form_data.large_lists && is_list_source (options.extra_data[i]) &&
+                  (fld->type == YAD_FIELD_COMBO || fld->type == YAD_FIELD_COMBO_ENTRY ||
+                   fld->type == YAD_FIELD_COMPLETE))
+                load_list_source (g_ptr_array_index (fields, i), options.extra_data[i]);
+              else
+                set_field_value (i, options.extra_data[i]);
               i++;
             }
         }
+
+      if (options.common_data.print_changes)
+        connect_changes ();
+
+      if (options.common_data.listen)
+        read_input (1, record_key, handle_stdin, NULL);
     }
 
   return w;
@@ -1031,141 +1770,10 @@ form_create_widget (GtkWidget * dlg)
 static void
 form_print_field (guint fn)
 {
-  gchar *buf;
-  YadField *fld = g_slist_nth_data (options.form_data.fields, fn);
-
-  switch (fld->type)
-    {
-    case YAD_FIELD_SIMPLE:
-    case YAD_FIELD_HIDDEN:
-    case YAD_FIELD_READ_ONLY:
-    case YAD_FIELD_COMPLETE:
-    case YAD_FIELD_MFILE:
-    case YAD_FIELD_MDIR:
-    case YAD_FIELD_FILE_SAVE:
-    case YAD_FIELD_DIR_CREATE:
-    case YAD_FIELD_DATE:
-      if (options.common_data.quoted_output)
-        {
-          buf = g_shell_quote (gtk_entry_get_text (GTK_ENTRY (g_slist_nth_data (fields, fn))));
-          g_printf ("%s%s", buf, options.common_data.separator);
-          g_free (buf);
-        }
-      else
-        g_printf ("%s%s", gtk_entry_get_text (GTK_ENTRY (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      break;
-    case YAD_FIELD_NUM:
-      if (options.common_data.quoted_output)
-        g_printf ("'%f'%s", gtk_spin_button_get_value (GTK_SPIN_BUTTON (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      else
-        g_printf ("%f%s", gtk_spin_button_get_value (GTK_SPIN_BUTTON (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      break;
-    case YAD_FIELD_CHECK:
-      if (options.common_data.quoted_output)
-        g_printf ("'%s'%s", gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (g_slist_nth_data (fields, fn))) ? "TRUE" :
-                  "FALSE", options.common_data.separator);
-      else
-        g_printf ("%s%s", gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (g_slist_nth_data (fields, fn))) ? "TRUE" :
-                  "FALSE", options.common_data.separator);
-      break;
-    case YAD_FIELD_COMBO:
-    case YAD_FIELD_COMBO_ENTRY:
-      if (options.common_data.quoted_output)
-        {
-#if GTK_CHECK_VERSION(2,24,0)
-          buf = g_shell_quote (gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (g_slist_nth_data (fields, fn))));
-#else
-          buf = g_shell_quote (gtk_combo_box_get_active_text (GTK_COMBO_BOX (g_slist_nth_data (fields, fn))));
-#endif
-          g_printf ("%s%s", buf, options.common_data.separator);
-          g_free (buf);
-        }
-      else
-        {
-          g_printf ("%s%s",
-#if GTK_CHECK_VERSION(2,24,0)
-                    gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (g_slist_nth_data (fields, fn))),
-#else
-                    gtk_combo_box_get_active_text (GTK_COMBO_BOX (g_slist_nth_data (fields, fn))),
-#endif
-                    options.common_data.separator);
-        }
-      break;
-    case YAD_FIELD_FILE:
-    case YAD_FIELD_DIR:
-      if (options.common_data.quoted_output)
-        {
-          gchar *fname = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (g_slist_nth_data (fields, fn)));
-          buf = g_shell_quote (fname ? fname : "");
-          g_free (fname);
-          g_printf ("%s%s", buf ? buf : "", options.common_data.separator);
-          g_free (buf);
-        }
-      else
-        {
-          buf = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (g_slist_nth_data (fields, fn)));
-          g_printf ("%s%s", buf ? buf : "", options.common_data.separator);
-          g_free (buf);
-        }
-      break;
-    case YAD_FIELD_FONT:
-      if (options.common_data.quoted_output)
-        g_printf ("'%s'%s", gtk_font_button_get_font_name (GTK_FONT_BUTTON (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      else
-        g_printf ("%s%s", gtk_font_button_get_font_name (GTK_FONT_BUTTON (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      break;
-    case YAD_FIELD_COLOR:
-      {
-        GdkColor c;
+  gchar *val = format_field (fn);
 
-        gtk_color_button_get_color (GTK_COLOR_BUTTON (g_slist_nth_data (fields, fn)), &c);
-        if (options.common_data.quoted_output)
-          g_printf ("'%s'%s", gdk_color_to_string (&c), options.common_data.separator);
-        else
-          g_printf ("%s%s", gdk_color_to_string (&c), options.common_data.separator);
-        break;
-      }
-    case YAD_FIELD_SCALE:
-      if (options.common_data.quoted_output)
-        g_printf ("'%d'%s", (gint) gtk_range_get_value (GTK_RANGE (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      else
-        g_printf ("%d%s", (gint) gtk_range_get_value (GTK_RANGE (g_slist_nth_data (fields, fn))),
-                  options.common_data.separator);
-      break;
-    case YAD_FIELD_BUTTON:
-    case YAD_FIELD_FULL_BUTTON:
-    case YAD_FIELD_LABEL:
-      if (options.common_data.quoted_output)
-        g_printf ("''%s", options.common_data.separator);
-      else
-        g_printf ("%s", options.common_data.separator);
-      break;
-    case YAD_FIELD_TEXT:
-      {
-        gchar *txt;
-        GtkTextBuffer *tb;
-        GtkTextIter b, e;
-
-        tb = gtk_text_view_get_buffer (GTK_TEXT_VIEW (g_slist_nth_data (fields, fn)));
-        gtk_text_buffer_get_bounds (tb, &b, &e);
-        txt = escape_str (gtk_text_buffer_get_text (tb, &b, &e, FALSE));
-        if (options.common_data.quoted_output)
-          {
-            buf = g_shell_quote (txt);
-            g_printf ("%s%s", buf, options.common_data.separator);
-            g_free (buf);
-          }
-        else
-          g_printf ("%s%s", txt, options.common_data.separator);
-        g_free (txt);
-      }
-    }
+  g_printf ("%s", val);
+  g_free (val);
 }
 
 void
@@ -21,14 +21,15 @@
 #include <stdlib.h>
 
 #include <glib/gprintf.h>
+#include <gio/gunixinputstream.h>
+#define LIBSOUP_USE_UNSTABLE_REQUEST_API
+#include <libsoup/soup-request.h>
 #include <webkit/webkit.h>
 
 #include "yad.h"
 
 static WebKitWebView *view;
 
-static GString *inbuf;
-
 static gboolean is_link = FALSE;
 static gboolean is_loaded = FALSE;
 
@@ -201,32 +202,84 @@ menu_cb (WebKitWebView * view, GtkWidget * menu, WebKitHitTestResult * hit, gboo
   return FALSE;
 }
 
+/* yad-stdin: request. webkit reads stdin as it comes, so page is shown before the end of data */
+#define YAD_STDIN_URI "yad-stdin:///"
+
+typedef struct {
+  SoupRequest parent;
+} YadStdinRequest;
+
+typedef struct {
+  SoupRequestClass parent_class;
+} YadStdinRequestClass;
+
+G_DEFINE_TYPE (YadStdinRequest, yad_stdin_request, SOUP_TYPE_REQUEST);
+
+static gboolean stdin_sent = FALSE;
+
+/* relative links of the page resolve to yad-stdin: too, but only the page itself is stdin */
 static gboolean
-handle_stdin (GIOChannel * ch, GIOCondition cond, gpointer d)
+stdin_check_uri (SoupRequest * req, SoupURI * uri, GError ** err)
 {
-  gchar *buf;
-  GError *err = NULL;
+  if ((uri->host && *uri->host) || g_strcmp0 (uri->path, "/") != 0 || uri->query)
+    {
+      g_set_error (err, SOUP_REQUEST_ERROR, SOUP_REQUEST_ERROR_BAD_URI, _("Invalid URI: %s"), uri->path);
+      return FALSE;
+    }
+
+  return TRUE;
+}
 
-  switch (g_io_channel_read_line (ch, &buf, NULL, NULL, &err))
+/* stdin can be read only once, so reload of the page gets an error */
+static GInputStream *
+stdin_send (SoupRequest * req, GCancellable * cancel, GError ** err)
+{
+  if (stdin_sent)
     {
-    case G_IO_STATUS_NORMAL:
-      g_string_append (inbuf, buf);
-      return TRUE;
+      g_set_error (err, G_IO_ERROR, G_IO_ERROR_CLOSED, _("Standard input is already read"));
+      return NULL;
+    }
+  stdin_sent = TRUE;
 
-    case G_IO_STATUS_ERROR:
-      g_printerr ("yad_html_handle_stdin(): %s\n", err->message);
-      g_error_free (err);
-      return FALSE;
+  return g_unix_input_stream_new (0, FALSE);
+}
 
-    case G_IO_STATUS_EOF:
-      webkit_web_view_load_string (view, inbuf->str, options.html_data.mime, options.html_data.encoding, NULL);
-      return FALSE;
+static goffset
+stdin_get_content_length (SoupRequest * req)
+{
+  return -1;
+}
+
+static const gchar *
+stdin_get_content_type (SoupRequest * req)
+{
+  static gchar *type = NULL;
 
-    case G_IO_STATUS_AGAIN:
-      return TRUE;
+  if (!type)
+    {
+      type = g_strdup_printf ("%s; charset=%s", options.html_data.mime ? options.html_data.mime : "text/html",
+                              options.html_data.encoding ? options.html_data.encoding : "UTF-8");
     }
 
-  return FALSE;
+  return type;
+}
+
+static void
+yad_stdin_request_class_init (YadStdinRequestClass * klass)
+{
+  static const gchar *schemes[] = { "yad-stdin", NULL };
+  SoupRequestClass *req_class = SOUP_REQUEST_CLASS (klass);
+
+  req_class->schemes = schemes;
+  req_class->check_uri = stdin_check_uri;
+  req_class->send = stdin_send;
+  req_class->get_content_length = stdin_get_content_length;
+  req_class->get_content_type = stdin_get_content_type;
+}
+
+static void
+yad_stdin_request_init (YadStdinRequest * req)
+{
 }
 
 GtkWidget *
@@ -266,13 +319,8 @@ html_create_widget (GtkWidget * dlg)
     load_uri (options.html_data.uri);
   else if (!options.html_data.browser)
     {
-      GIOChannel *ch;
-
-      inbuf = g_string_new (NULL);
-      ch = g_io_channel_unix_new (0);
-      g_io_channel_set_encoding (ch, NULL, NULL);
-      g_io_channel_set_flags (ch, G_IO_FLAG_NONBLOCK, NULL);
-      g_io_add_watch (ch, G_IO_IN | G_IO_HUP, handle_stdin, NULL);
+      soup_session_add_feature_by_type (sess, yad_stdin_request_get_type ());
+      webkit_web_view_load_uri (view, YAD_STDIN_URI);
     }
 
   return sw;
@@ -17,6 +17,10 @@
  * Copyright (C) 2008-2015, Victor Ananjevsky <ananasik@gmail.com>
  */
 
+#include <stdlib.h>
+
+#include <glib/gstdio.h>
+
 #include "yad.h"
 
 static GtkWidget *icon_view;
@@ -28,6 +32,9 @@ enum {
   COL_PIXBUF,
   COL_COMMAND,
   COL_TERM,
+  /* hidden columns. name of the icon which is not loaded yet and loading state */
+  COL_ICON,
+  COL_LOADING,
   NUM_COLS
 };
 
@@ -37,13 +44,75 @@ enum {
 };
 
 typedef struct {
+  gchar *filename;
+  gint64 mtime;
+  /* record from the cache file, if entry wasn't changed */
+  GVariant *cached;
   gchar *name;
   gchar *comment;
+  gchar *icon;
   GdkPixbuf *pixbuf;
   gchar *command;
   gboolean in_term;
 } DEntry;
 
+/* directory scan. files are parsed in a thread pool and added to the store in batches */
+typedef struct {
+  GtkListStore *store;
+  GThreadPool *pool;
+  GAsyncQueue *results;
+  guint pending;
+  /* entries cache */
+  gchar *cache_file;
+  GHashTable *records;
+  gboolean dirty;
+  guint save_timeout;
+  /* rows of the store by file name */
+  GHashTable *rows;
+  guint add_timeout;
+  /* directory monitor and file names changed since the last refresh */
+  GFileMonitor *monitor;
+  GHashTable *changed;
+  guint changed_timeout;
+} ScanData;
+
+/* icons are decoded in a thread pool only for visible rows */
+typedef struct {
+  GThreadPool *pool;
+  GAsyncQueue *results;
+  /* requests in flight */
+  GList *requests;
+  guint results_timeout;
+  guint update_idle;
+  /* private icon theme of the workers. lookups are serialized, loading is not */
+  GtkIconTheme *theme;
+  GMutex theme_lock;
+  gint icon_size;
+  /* also used as a placeholder */
+  GdkPixbuf *fallback;
+} IconLoader;
+
+typedef struct {
+  GtkTreeRowReference *ref;
+  gchar *icon;
+  gint cancelled;
+  gboolean loaded;
+  GdkPixbuf *pixbuf;
+} IconRequest;
+
+static ScanData *scan = NULL;
+static IconLoader loader;
+
+#define ICONS_CACHE_VERSION 2
+/* file name, mtime, name, comment, command, icon, terminal, width, height, rowstride, alpha, pixels */
+#define ICONS_CACHE_RECORD "(sxssssbiiibay)"
+#define ICONS_CACHE_TYPE "(ua" ICONS_CACHE_RECORD ")"
+
+/* time for coalescing directory changes */
+#define ICONS_REFRESH_DELAY 300
+/* time for coalescing cache updates */
+#define ICONS_SAVE_DELAY 2
+
 static void
 select_cb (GObject * obj, gpointer data)
 {
@@ -117,14 +186,15 @@ activate_cb (GtkWidget * view, GtkTreePath * path, gpointer data)
     }
 }
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
 {
   static GtkTreeIter iter;
   static gint column_count = 1;
   static gint row_count = 0;
   static gboolean first_time = TRUE;
   GtkTreeModel *model;
+  guint i;
 
   if (!options.icons_data.compact)
     model = gtk_icon_view_get_model (GTK_ICON_VIEW (icon_view));
@@ -138,96 +208,49 @@ handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
       gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_FILENAME, "", -1);
     }
 
-  if ((condition == G_IO_IN) || (condition == G_IO_IN + G_IO_HUP))
+  for (i = 0; i < n_lines; i++)
     {
-      GError *err = NULL;
-      GString *string = g_string_new (NULL);
-
-      while (channel->is_readable != TRUE);
+      gchar *line = lines[i];
 
-      do
+      if (column_count == COL_ICON)
         {
-          GdkPixbuf *pb;
-          gint status;
-
-          do
-            {
-              status = g_io_channel_read_line_string (channel, string, NULL, &err);
-
-              while (gtk_events_pending ())
-                gtk_main_iteration ();
-            }
-          while (status == G_IO_STATUS_AGAIN);
-          strip_new_line (string->str);
-
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (err)
-                {
-                  g_printerr ("yad_icons_handle_stdin(): %s\n", err->message);
-                  g_error_free (err);
-                  err = NULL;
-                }
-              /* stop handling */
-              g_io_channel_shutdown (channel, TRUE, NULL);
-              return FALSE;
-            }
-
-          if (column_count == NUM_COLS)
-            {
-              /* We're starting a new row */
-              column_count = 1;
-              row_count++;
-              gtk_list_store_append (GTK_LIST_STORE (model), &iter);
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_FILENAME, "", -1);
-            }
-
-          switch (column_count)
-            {
-            case COL_NAME:
-            case COL_COMMAND:
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, string->str, -1);
-              break;
-            case COL_TOOLTIP:
-              {
-                gchar *buf = g_markup_escape_text (string->str, -1);
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, buf, -1);
-                g_free (buf);
-                break;
-              }
-            case COL_PIXBUF:
-              if (options.icons_data.compact)
-                if (*string->str)
-                  pb = get_pixbuf (string->str, YAD_SMALL_ICON);
-                else
-                  pb = NULL;
-              else
-                pb = get_pixbuf (string->str, YAD_BIG_ICON);
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, pb, -1);
-              if (pb)
-                g_object_unref (pb);
-              break;
-            case COL_TERM:
-              if (strcasecmp (string->str, "true") == 0)
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, TRUE, -1);
-              else
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, FALSE, -1);
-              break;
-            }
+          /* We're starting a new row */
+          column_count = 1;
+          row_count++;
+          gtk_list_store_append (GTK_LIST_STORE (model), &iter);
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_FILENAME, "", -1);
+        }
 
-          column_count++;
+      switch (column_count)
+        {
+        case COL_NAME:
+        case COL_COMMAND:
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, line, -1);
+          break;
+        case COL_TOOLTIP:
+          {
+            gchar *buf = g_markup_escape_text (line, -1);
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, buf, -1);
+            g_free (buf);
+            break;
+          }
+        case COL_PIXBUF:
+          /* icon is loaded when the row becomes visible */
+          if (*line)
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_PIXBUF, loader.fallback, COL_ICON, line, -1);
+          else if (!options.icons_data.compact)
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_PIXBUF, loader.fallback, -1);
+          break;
+        case COL_TERM:
+          if (strcasecmp (line, "true") == 0)
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, TRUE, -1);
+          else
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, FALSE, -1);
+          break;
         }
-      while (g_io_channel_get_buffer_condition (channel) == G_IO_IN);
-      g_string_free (string, TRUE);
-    }
 
-  if ((condition != G_IO_IN) && (condition != G_IO_IN + G_IO_HUP))
-    {
-      g_io_channel_shutdown (channel, TRUE, NULL);
-      return FALSE;
+      column_count++;
     }
-
-  return TRUE;
 }
 
 static DEntry *
@@ -242,8 +265,6 @@ parse_desktop_file (gchar * filename)
 
   if (g_key_file_load_from_file (kf, filename, 0, &err))
     {
-      gchar *icon;
-
       if (g_key_file_has_group (kf, "Desktop Entry"))
         {
           gint i, type;
@@ -309,16 +330,8 @@ parse_desktop_file (gchar * filename)
                 }
             }
 
-          /* add icon */
-          icon = g_key_file_get_string (kf, "Desktop Entry", "Icon", NULL);
-          if (icon)
-            {
-              if (options.icons_data.compact)
-                ent->pixbuf = get_pixbuf (icon, YAD_SMALL_ICON);
-              else
-                ent->pixbuf = get_pixbuf (icon, YAD_BIG_ICON);
-              g_free (icon);
-            }
+          /* icon is loaded later */
+          ent->icon = g_key_file_get_string (kf, "Desktop Entry", "Icon", NULL);
         }
     }
   else
@@ -329,12 +342,627 @@ parse_desktop_file (gchar * filename)
   return ent;
 }
 
+static void
+free_entry (DEntry * ent)
+{
+  g_free (ent->filename);
+  g_free (ent->name);
+  g_free (ent->comment);
+  g_free (ent->icon);
+  g_free (ent->command);
+  if (ent->pixbuf)
+    g_object_unref (ent->pixbuf);
+  if (ent->cached)
+    g_variant_unref (ent->cached);
+  g_free (ent);
+}
+
+static void
+free_pixels (guchar * pixels, gpointer data)
+{
+  g_variant_unref ((GVariant *) data);
+}
+
+/* cache keeps pixels in pixbuf layout, so cached icons use the mapped file directly */
+static DEntry *
+entry_from_record (GVariant * rec)
+{
+  DEntry *ent;
+  GVariant *pv;
+  const guchar *pixels;
+  gchar *name, *comment, *command, *icon;
+  gboolean term, alpha;
+  gint w, h, rs;
+  gsize len;
+
+  g_variant_get (rec, "(&sx&s&s&s&sbiiib@ay)", NULL, NULL, &name, &comment, &command, &icon,
+                 &term, &w, &h, &rs, &alpha, &pv);
+
+  ent = g_new0 (DEntry, 1);
+  ent->cached = g_variant_ref (rec);
+  /* empty name marks file which is not a valid desktop entry */
+  if (*name)
+    ent->name = g_strdup (name);
+  ent->comment = g_strdup (comment);
+  ent->command = g_strdup (command);
+  ent->in_term = term;
+
+  pixels = g_variant_get_fixed_array (pv, &len, 1);
+  if (w > 0 && h > 0 && rs >= w * (alpha ? 4 : 3) && len >= (gsize) rs * (h - 1) + w * (alpha ? 4 : 3))
+    ent->pixbuf = gdk_pixbuf_new_from_data (pixels, GDK_COLORSPACE_RGB, alpha, 8, w, h, rs, free_pixels, pv);
+  else
+    {
+      /* icon wasn't shown yet */
+      if (*icon)
+        ent->icon = g_strdup (icon);
+      g_variant_unref (pv);
+    }
+
+  return ent;
+}
+
+static GVariant *
+record_from_entry (DEntry * ent)
+{
+  GVariant *pv;
+  gint w = 0, h = 0, rs = 0;
+  gboolean alpha = FALSE;
+
+  if (ent->pixbuf && gdk_pixbuf_get_colorspace (ent->pixbuf) == GDK_COLORSPACE_RGB &&
+      gdk_pixbuf_get_bits_per_sample (ent->pixbuf) == 8)
+    {
+      w = gdk_pixbuf_get_width (ent->pixbuf);
+      h = gdk_pixbuf_get_height (ent->pixbuf);
+      rs = gdk_pixbuf_get_rowstride (ent->pixbuf);
+      alpha = gdk_pixbuf_get_has_alpha (ent->pixbuf);
+      pv = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, gdk_pixbuf_get_pixels (ent->pixbuf),
+                                      (gsize) rs * (h - 1) + w * (alpha ? 4 : 3), 1);
+    }
+  else
+    pv = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, NULL, 0, 1);
+
+  return g_variant_new ("(sxssssbiiib@ay)", ent->filename, ent->mtime,
+                        ent->name ? ent->name : "", ent->comment ? ent->comment : "",
+                        ent->command ? ent->command : "", ent->icon ? ent->icon : "",
+                        ent->in_term, w, h, rs, alpha, pv);
+}
+
+static GHashTable *
+load_cache (ScanData * sd)
+{
+  GMappedFile *mf;
+  GBytes *bytes;
+  GVariant *cache, *recs;
+  GHashTable *tbl;
+  guint32 ver;
+  gsize i;
+
+  tbl = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_variant_unref);
+
+  mf = g_mapped_file_new (sd->cache_file, FALSE, NULL);
+  if (!mf)
+    return tbl;
+  bytes = g_mapped_file_get_bytes (mf);
+  g_mapped_file_unref (mf);
+
+  /* GVariant checks untrusted data on access */
+  cache = g_variant_new_from_bytes (G_VARIANT_TYPE (ICONS_CACHE_TYPE), bytes, FALSE);
+  g_bytes_unref (bytes);
+
+  g_variant_get (cache, "(u@a" ICONS_CACHE_RECORD ")", &ver, &recs);
+  if (ver == ICONS_CACHE_VERSION)
+    {
+      for (i = 0; i < g_variant_n_children (recs); i++)
+        {
+          GVariant *rec = g_variant_get_child_value (recs, i);
+          const gchar *fn;
+
+          g_variant_get_child (rec, 0, "&s", &fn);
+          g_hash_table_replace (tbl, (gpointer) fn, rec);
+        }
+    }
+  g_variant_unref (recs);
+  g_variant_unref (cache);
+
+  return tbl;
+}
+
+static void
+save_cache (ScanData * sd)
+{
+  GVariantBuilder b;
+  GVariant *cache;
+  GHashTableIter it;
+  gpointer rec;
+  gchar *dir;
+
+  g_variant_builder_init (&b, G_VARIANT_TYPE ("a" ICONS_CACHE_RECORD));
+  g_hash_table_iter_init (&it, sd->records);
+  while (g_hash_table_iter_next (&it, NULL, &rec))
+    g_variant_builder_add_value (&b, (GVariant *) rec);
+  cache = g_variant_ref_sink (g_variant_new ("(u@a" ICONS_CACHE_RECORD ")", ICONS_CACHE_VERSION,
+                                             g_variant_builder_end (&b)));
+
+  dir = g_path_get_dirname (sd->cache_file);
+  if (g_mkdir_with_parents (dir, 0700) != -1)
+    g_file_set_contents (sd->cache_file, g_variant_get_data (cache), g_variant_get_size (cache), NULL);
+  g_free (dir);
+
+  g_variant_unref (cache);
+}
+
+static gboolean
+save_cache_cb (gpointer data)
+{
+  ScanData *sd = (ScanData *) data;
+
+  save_cache (sd);
+  sd->dirty = FALSE;
+  sd->save_timeout = 0;
+
+  return FALSE;
+}
+
+static void
+schedule_save (ScanData * sd)
+{
+  if (sd->dirty && !sd->save_timeout)
+    sd->save_timeout = g_timeout_add_seconds (ICONS_SAVE_DELAY, save_cache_cb, sd);
+}
+
+/* dialog usually closes before the delayed save, so the last changes are saved on exit */
+static void
+flush_cache (void)
+{
+  if (!scan || !scan->dirty)
+    return;
+
+  if (scan->save_timeout)
+    g_source_remove (scan->save_timeout);
+  save_cache_cb (scan);
+}
+
+static GtkTreeModel *
+get_model (void)
+{
+  if (!options.icons_data.compact)
+    return gtk_icon_view_get_model (GTK_ICON_VIEW (icon_view));
+  else
+    return gtk_tree_view_get_model (GTK_TREE_VIEW (icon_view));
+}
+
+/* runs in a pool thread */
+static void
+load_icon_func (gpointer data, gpointer user_data)
+{
+  IconRequest *req = (IconRequest *) data;
+  GdkPixbuf *pb = NULL;
+  GError *err = NULL;
+
+  /* row was scrolled away while the request was waiting */
+  if (g_atomic_int_get (&req->cancelled))
+    {
+      g_async_queue_push (loader.results, req);
+      return;
+    }
+
+  if (g_file_test (req->icon, G_FILE_TEST_EXISTS))
+    {
+      pb = gdk_pixbuf_new_from_file (req->icon, &err);
+      if (!pb)
+        {
+          g_printerr ("yad_get_pixbuf(): %s\n", err->message);
+          g_error_free (err);
+        }
+    }
+  else
+    {
+      GtkIconInfo *info;
+
+      g_mutex_lock (&loader.theme_lock);
+      info = gtk_icon_theme_lookup_icon (loader.theme, req->icon, loader.icon_size, GTK_ICON_LOOKUP_GENERIC_FALLBACK);
+      g_mutex_unlock (&loader.theme_lock);
+
+      if (info)
+        {
+          pb = gtk_icon_info_load_icon (info, NULL);
+          gtk_icon_info_free (info);
+        }
+    }
+
+  if (!pb && loader.fallback)
+    pb = g_object_ref (loader.fallback);
+
+  req->pixbuf = pb;
+  req->loaded = TRUE;
+
+  g_async_queue_push (loader.results, req);
+}
+
+static void schedule_update (void);
+
+/* store loaded icon in the entries cache */
+static void
+cache_icon (GtkTreeModel * model, GtkTreeIter * iter, GdkPixbuf * pb)
+{
+  GVariant *rec;
+  DEntry *ent;
+  gchar *filename;
+
+  if (!scan)
+    return;
+
+  gtk_tree_model_get (model, iter, COL_FILENAME, &filename, -1);
+  rec = g_hash_table_lookup (scan->records, filename);
+  if (rec)
+    {
+      ent = entry_from_record (rec);
+      ent->filename = filename;
+      g_variant_get_child (rec, 1, "x", &ent->mtime);
+      if (ent->pixbuf)
+        g_object_unref (ent->pixbuf);
+      ent->pixbuf = g_object_ref (pb);
+      g_free (ent->icon);
+      ent->icon = NULL;
+
+      g_hash_table_replace (scan->records, g_strdup (filename), g_variant_ref_sink (record_from_entry (ent)));
+      free_entry (ent);
+
+      scan->dirty = TRUE;
+      schedule_save (scan);
+    }
+  else
+    g_free (filename);
+}
+
+static gboolean
+icons_loaded_cb (gpointer data)
+{
+  GtkTreeModel *model = get_model ();
+  IconRequest *req;
+
+  while ((req = g_async_queue_try_pop (loader.results)) != NULL)
+    {
+      GtkTreePath *path;
+      GtkTreeIter iter;
+
+      loader.requests = g_list_remove (loader.requests, req);
+
+      path = gtk_tree_row_reference_get_path (req->ref);
+      if (path && gtk_tree_model_get_iter (model, &iter, path))
+        {
+          gchar *icon;
+
+          /* row may be changed while icon was loading */
+          gtk_tree_model_get (model, &iter, COL_ICON, &icon, -1);
+          if (req->loaded && g_strcmp0 (icon, req->icon) == 0)
+            {
+              gtk_list_store_set (GTK_LIST_STORE (model), &iter,
+                                  COL_PIXBUF, req->pixbuf, COL_ICON, NULL, COL_LOADING, FALSE, -1);
+              if (req->pixbuf)
+                cache_icon (model, &iter, req->pixbuf);
+            }
+          else
+            {
+              gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_LOADING, FALSE, -1);
+              schedule_update ();
+            }
+          g_free (icon);
+        }
+      if (path)
+        gtk_tree_path_free (path);
+
+      gtk_tree_row_reference_free (req->ref);
+      g_free (req->icon);
+      if (req->pixbuf)
+        g_object_unref (req->pixbuf);
+      g_free (req);
+    }
+
+  if (loader.requests)
+    return TRUE;
+
+  loader.results_timeout = 0;
+  return FALSE;
+}
+
+static gboolean
+update_visible_cb (gpointer data)
+{
+  GtkTreeModel *model = get_model ();
+  GtkTreePath *start, *end, *path;
+  GtkTreeIter iter;
+  GList *l;
+  gboolean res;
+
+  loader.update_idle = 0;
+
+  if (!options.icons_data.compact)
+    res = gtk_icon_view_get_visible_range (GTK_ICON_VIEW (icon_view), &start, &end);
+  else
+    res = gtk_tree_view_get_visible_range (GTK_TREE_VIEW (icon_view), &start, &end);
+  if (!res)
+    return FALSE;
+
+  /* cancel requests for rows which are not visible anymore */
+  for (l = loader.requests; l; l = l->next)
+    {
+      IconRequest *req = (IconRequest *) l->data;
+
+      path = gtk_tree_row_reference_get_path (req->ref);
+      if (!path || gtk_tree_path_compare (path, start) < 0 || gtk_tree_path_compare (path, end) > 0)
+        g_atomic_int_set (&req->cancelled, 1);
+      if (path)
+        gtk_tree_path_free (path);
+    }
+
+  /* request icons of visible rows from top to bottom */
+  path = gtk_tree_path_copy (start);
+  while (gtk_tree_path_compare (path, end) <= 0 && gtk_tree_model_get_iter (model, &iter, path))
+    {
+      gchar *icon;
+      gboolean loading;
+
+      gtk_tree_model_get (model, &iter, COL_ICON, &icon, COL_LOADING, &loading, -1);
+      if (icon && !loading)
+        {
+          IconRequest *req = g_new0 (IconRequest, 1);
+
+          req->ref = gtk_tree_row_reference_new (model, path);
+          req->icon = icon;
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_LOADING, TRUE, -1);
+
+          loader.requests = g_list_prepend (loader.requests, req);
+          g_thread_pool_push (loader.pool, req, NULL);
+        }
+      else
+        g_free (icon);
+
+      gtk_tree_path_next (path);
+    }
+  gtk_tree_path_free (path);
+  gtk_tree_path_free (start);
+  gtk_tree_path_free (end);
+
+  if (loader.requests && !loader.results_timeout)
+    loader.results_timeout = g_timeout_add (50, icons_loaded_cb, NULL);
+
+  return FALSE;
+}
+
+static void
+schedule_update (void)
+{
+  /* idle runs after layout, so visible range is actual */
+  if (!loader.update_idle)
+    loader.update_idle = g_idle_add (update_visible_cb, NULL);
+}
+
+static void
+scroll_cb (GtkAdjustment * adj, gpointer data)
+{
+  schedule_update ();
+}
+
+static void
+row_inserted_cb (GtkTreeModel * model, GtkTreePath * path, GtkTreeIter * iter, gpointer data)
+{
+  schedule_update ();
+}
+
+static void
+init_loader (void)
+{
+  gchar *theme_name = NULL, **path;
+  gint n, w, h;
+
+  if (options.icons_data.compact)
+    {
+      gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &w, &h);
+      loader.fallback = settings.small_fallback_image;
+    }
+  else
+    {
+      gtk_icon_size_lookup (GTK_ICON_SIZE_DIALOG, &w, &h);
+      loader.fallback = settings.big_fallback_image;
+    }
+  loader.icon_size = MIN (w, h);
+
+  /* icon theme is not thread-safe, so workers use their own copy, detached from screen settings */
+  if (options.data.icon_theme)
+    theme_name = g_strdup (options.data.icon_theme);
+  else
+    g_object_get (gtk_settings_get_default (), "gtk-icon-theme-name", &theme_name, NULL);
+  loader.theme = gtk_icon_theme_new ();
+  gtk_icon_theme_set_custom_theme (loader.theme, theme_name);
+  g_free (theme_name);
+  gtk_icon_theme_get_search_path (settings.icon_theme, &path, &n);
+  gtk_icon_theme_set_search_path (loader.theme, (const gchar **) path, n);
+  g_strfreev (path);
+  /* load theme index before starting the workers */
+  gtk_icon_theme_has_icon (loader.theme, "yad");
+  g_mutex_init (&loader.theme_lock);
+
+  loader.results = g_async_queue_new ();
+  loader.pool = g_thread_pool_new (load_icon_func, NULL, g_get_num_processors (), FALSE, NULL);
+}
+
+/* runs in a pool thread */
+static void
+parse_file_func (gpointer data, gpointer user_data)
+{
+  ScanData *sd = (ScanData *) user_data;
+  DEntry *ent, *fe = (DEntry *) data;
+  gchar *fullname;
+
+  fullname = g_build_filename (options.icons_data.directory, fe->filename, NULL);
+  ent = parse_desktop_file (fullname);
+  g_free (fullname);
+
+  ent->filename = fe->filename;
+  ent->mtime = fe->mtime;
+  g_free (fe);
+
+  g_async_queue_push (sd->results, ent);
+}
+
+static void
+remove_entry (ScanData * sd, const gchar * filename)
+{
+  GtkTreeIter *iter = g_hash_table_lookup (sd->rows, filename);
+
+  if (iter)
+    {
+      gtk_list_store_remove (sd->store, iter);
+      g_hash_table_remove (sd->rows, filename);
+    }
+  if (g_hash_table_remove (sd->records, filename))
+    sd->dirty = TRUE;
+}
+
+static gboolean
+add_entries_cb (gpointer data)
+{
+  ScanData *sd = (ScanData *) data;
+  DEntry *ent;
+
+  while ((ent = g_async_queue_try_pop (sd->results)) != NULL)
+    {
+      sd->pending--;
+
+      if (ent->name)
+        {
+          GtkTreeIter iter, *row = g_hash_table_lookup (sd->rows, ent->filename);
+
+          /* placeholder is shown until the icon is loaded */
+          GdkPixbuf *pb = ent->pixbuf ? ent->pixbuf : (ent->icon ? loader.fallback : NULL);
+
+          if (row)
+            {
+              gtk_list_store_set (sd->store, row,
+                                  COL_NAME, ent->name,
+                                  COL_TOOLTIP, ent->comment ? ent->comment : "",
+                                  COL_PIXBUF, pb,
+                                  COL_COMMAND, ent->command ? ent->command : "",
+                                  COL_TERM, ent->in_term,
+                                  COL_ICON, ent->pixbuf ? NULL : ent->icon, -1);
+              schedule_update ();
+            }
+          else
+            {
+              gtk_list_store_insert_with_values (sd->store, &iter, -1,
+                                                 COL_FILENAME, ent->filename,
+                                                 COL_NAME, ent->name,
+                                                 COL_TOOLTIP, ent->comment ? ent->comment : "",
+                                                 COL_PIXBUF, pb,
+                                                 COL_COMMAND, ent->command ? ent->command : "",
+                                                 COL_TERM, ent->in_term,
+                                                 COL_ICON, ent->pixbuf ? NULL : ent->icon, -1);
+              /* list store iters are persistent */
+              g_hash_table_insert (sd->rows, g_strdup (ent->filename), gtk_tree_iter_copy (&iter));
+            }
+        }
+      else
+        remove_entry (sd, ent->filename);
+
+      if (ent->cached)
+        g_hash_table_replace (sd->records, g_strdup (ent->filename), g_variant_ref (ent->cached));
+      else
+        {
+          g_hash_table_replace (sd->records, g_strdup (ent->filename), g_variant_ref_sink (record_from_entry (ent)));
+          sd->dirty = TRUE;
+        }
+      free_entry (ent);
+    }
+
+  if (sd->pending > 0)
+    return TRUE;
+
+  /* update cache if some files were changed or removed */
+  schedule_save (sd);
+  sd->add_timeout = 0;
+
+  return FALSE;
+}
+
+static void
+parse_entry (ScanData * sd, const gchar * filename, gint64 mtime)
+{
+  DEntry *ent = g_new0 (DEntry, 1);
+
+  ent->filename = g_strdup (filename);
+  ent->mtime = mtime;
+
+  sd->pending++;
+  g_thread_pool_push (sd->pool, ent, NULL);
+
+  if (!sd->add_timeout)
+    sd->add_timeout = g_timeout_add (50, add_entries_cb, sd);
+}
+
+static gboolean
+refresh_cb (gpointer data)
+{
+  ScanData *sd = (ScanData *) data;
+  GHashTableIter it;
+  gpointer key;
+
+  g_hash_table_iter_init (&it, sd->changed);
+  while (g_hash_table_iter_next (&it, &key, NULL))
+    {
+      GStatBuf st;
+      gchar *fullname;
+
+      fullname = g_build_filename (options.icons_data.directory, (gchar *) key, NULL);
+      if (g_stat (fullname, &st) == 0)
+        parse_entry (sd, (gchar *) key, st.st_mtime);
+      else
+        remove_entry (sd, (gchar *) key);
+      g_free (fullname);
+    }
+  g_hash_table_remove_all (sd->changed);
+  sd->changed_timeout = 0;
+
+  if (!sd->pending)
+    schedule_save (sd);
+
+  return FALSE;
+}
+
+static void
+dir_changed_cb (GFileMonitor * mon, GFile * file, GFile * other, GFileMonitorEvent ev, gpointer data)
+{
+  ScanData *sd = (ScanData *) data;
+  gchar *filename;
+
+  if (ev != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT && ev != G_FILE_MONITOR_EVENT_CREATED &&
+      ev != G_FILE_MONITOR_EVENT_DELETED && ev != G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    return;
+
+  filename = g_file_get_basename (file);
+  if (!g_str_has_suffix (filename, ".desktop"))
+    {
+      g_free (filename);
+      return;
+    }
+
+  /* a burst of changes is handled at once */
+  g_hash_table_add (sd->changed, filename);
+  if (!sd->changed_timeout)
+    sd->changed_timeout = g_timeout_add (ICONS_REFRESH_DELAY, refresh_cb, sd);
+}
+
 static void
 read_dir (GtkListStore * store)
 {
   GDir *dir;
   const gchar *filename;
   GError *err = NULL;
+  ScanData *sd;
+  GHashTable *cache;
+  GFile *file;
+  gchar *key, *sum;
+  guint n_hits = 0;
 
   dir = g_dir_open (options.icons_data.directory, 0, &err);
   if (!dir)
@@ -343,40 +971,90 @@ read_dir (GtkListStore * store)
       return;
     }
 
+  /* scan data lives as long as the dialog */
+  sd = g_new0 (ScanData, 1);
+  sd->store = g_object_ref (store);
+  sd->results = g_async_queue_new ();
+  sd->rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) gtk_tree_iter_free);
+  sd->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  scan = sd;
+  atexit (flush_cache);
+
+  /* cache file depends on everything that affects parsed entries */
+  key = g_strdup_printf ("%s\n%d\n%d\n%s\n%d", options.icons_data.directory, options.icons_data.generic,
+                         options.icons_data.compact, options.data.icon_theme ? options.data.icon_theme : "",
+                         loader.icon_size);
+  sum = g_compute_checksum_for_string (G_CHECKSUM_MD5, key, -1);
+  sd->cache_file = g_strdup_printf ("%s/yad/icons-%s.cache", g_get_user_cache_dir (), sum);
+  g_free (sum);
+  g_free (key);
+
+  cache = load_cache (sd);
+  sd->records = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+
+  sd->pool = g_thread_pool_new (parse_file_func, sd, g_get_num_processors (), FALSE, NULL);
+
   while ((filename = g_dir_read_name (dir)) != NULL)
     {
-      DEntry *ent;
-      GtkTreeIter iter;
+      GVariant *rec;
+      GStatBuf st;
       gchar *fullname;
 
       if (!g_str_has_suffix (filename, ".desktop"))
         continue;
 
       fullname = g_build_filename (options.icons_data.directory, filename, NULL);
-      ent = parse_desktop_file (fullname);
+      if (g_stat (fullname, &st) == -1)
+        st.st_mtime = 0;
       g_free (fullname);
 
-      if (ent->name)
+      rec = g_hash_table_lookup (cache, filename);
+      if (rec && st.st_mtime != 0)
         {
-          gtk_list_store_append (store, &iter);
-          gtk_list_store_set (store, &iter,
-                              COL_FILENAME, filename,
-                              COL_NAME, ent->name,
-                              COL_TOOLTIP, ent->comment ? ent->comment : "",
-                              COL_PIXBUF, ent->pixbuf,
-                              COL_COMMAND, ent->command ? ent->command : "", COL_TERM, ent->in_term, -1);
+          gint64 mtime;
+
+          g_variant_get_child (rec, 1, "x", &mtime);
+          if (mtime != st.st_mtime)
+            rec = NULL;
         }
+      else
+        rec = NULL;
 
-      /* free desktop entry */
-      g_free (ent->name);
-      g_free (ent->comment);
-      g_free (ent->command);
-      if (ent->pixbuf)
-        g_object_unref (ent->pixbuf);
-      g_free (ent);
+      if (rec)
+        {
+          /* unchanged entries go directly to the store */
+          DEntry *ent = entry_from_record (rec);
+
+          ent->filename = g_strdup (filename);
+          ent->mtime = st.st_mtime;
+          sd->pending++;
+          g_async_queue_push (sd->results, ent);
+          n_hits++;
+        }
+      else
+        parse_entry (sd, filename, st.st_mtime);
     }
 
   g_dir_close (dir);
+
+  /* some files were removed since the cache was saved */
+  if (n_hits < g_hash_table_size (cache))
+    sd->dirty = TRUE;
+  g_hash_table_destroy (cache);
+
+  if (!sd->add_timeout)
+    sd->add_timeout = g_timeout_add (50, add_entries_cb, sd);
+
+  file = g_file_new_for_path (options.icons_data.directory);
+  sd->monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, &err);
+  if (sd->monitor)
+    g_signal_connect (G_OBJECT (sd->monitor), "changed", G_CALLBACK (dir_changed_cb), sd);
+  else
+    {
+      g_printerr (_("Unable to monitor directory %s: %s\n"), options.icons_data.directory, err->message);
+      g_error_free (err);
+    }
+  g_object_unref (file);
 }
 
 GtkWidget *
@@ -384,13 +1062,14 @@ icons_create_widget (GtkWidget * dlg)
 {
   GtkWidget *w;
   GtkListStore *store;
+  GtkAdjustment *adj;
 
   w = gtk_scrolled_window_new (NULL, NULL);
   gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (w), GTK_SHADOW_ETCHED_IN);
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (w), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
 
   store = gtk_list_store_new (NUM_COLS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
-                              GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_BOOLEAN);
+                              GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_BOOLEAN, G_TYPE_STRING, G_TYPE_BOOLEAN);
   gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
                                         options.icons_data.sort_by_name ? COL_NAME : COL_FILENAME,
                                         options.icons_data.descend ? GTK_SORT_DESCENDING : GTK_SORT_ASCENDING);
@@ -437,21 +1116,20 @@ icons_create_widget (GtkWidget * dlg)
         }
     }
 
+  /* load icons of visible items only */
+  init_loader ();
+  g_signal_connect (G_OBJECT (store), "row-inserted", G_CALLBACK (row_inserted_cb), NULL);
+  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (w));
+  g_signal_connect (G_OBJECT (adj), "value-changed", G_CALLBACK (scroll_cb), NULL);
+  g_signal_connect (G_OBJECT (adj), "changed", G_CALLBACK (scroll_cb), NULL);
+
   /* handle directory */
   if (options.icons_data.directory)
     read_dir (store);
   else if (options.common_data.listen)
     {
       /* read from stdin */
-      GIOChannel *channel;
-
-      channel = g_io_channel_unix_new (0);
-      if (channel)
-        {
-          g_io_channel_set_encoding (channel, NULL, NULL);
-          g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-          g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, NULL);
-        }
+      read_input (COL_ICON - 1, NULL, handle_stdin, NULL);
     }
 
   g_object_unref (store);
@@ -322,118 +322,77 @@ add_columns (gint n_columns)
     }
 }
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
 {
   static GtkTreeIter iter;
   static gint column_count = 0;
   static gint row_count = 0;
   gint n_columns = GPOINTER_TO_INT (data);
   GtkTreeModel *model = gtk_tree_view_get_model (GTK_TREE_VIEW (list_view));
+  guint i;
 
-  if ((condition == G_IO_IN) || (condition == G_IO_IN + G_IO_HUP))
+  for (i = 0; i < n_lines; i++)
     {
-      GError *err = NULL;
-      GString *string = g_string_new (NULL);
+      YadColumn *col;
+      GdkPixbuf *pb;
+      gchar *line = lines[i];
 
-      while (channel->is_readable != TRUE);
-
-      do
+      if (line[0] == '\014')
         {
-          YadColumn *col;
-          GdkPixbuf *pb;
-          gint status;
-
-          do
-            {
-              status = g_io_channel_read_line_string (channel, string, NULL, &err);
-
-              while (gtk_events_pending ())
-                gtk_main_iteration ();
-            }
-          while (status == G_IO_STATUS_AGAIN);
-
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (err)
-                {
-                  g_printerr ("yad_list_handle_stdin(): %s\n", err->message);
-                  g_error_free (err);
-                  err = NULL;
-                }
-              /* stop handling */
-              g_io_channel_shutdown (channel, TRUE, NULL);
-              return FALSE;
-            }
-
-          strip_new_line (string->str);
-          if (string->str[0] == '\014')
-            {
-              /* clear list if ^L received */
-              gtk_list_store_clear (GTK_LIST_STORE (model));
-              row_count = column_count = 0;
-              continue;
-            }
+          /* clear list if ^L received */
+          gtk_list_store_clear (GTK_LIST_STORE (model));
+          row_count = column_count = 0;
+          continue;
+        }
 
-          if (row_count == 0 && column_count == 0)
-            gtk_list_store_append (GTK_LIST_STORE (model), &iter);
-          else if (column_count == n_columns)
+      if (row_count == 0 && column_count == 0)
+        gtk_list_store_append (GTK_LIST_STORE (model), &iter);
+      else if (column_count == n_columns)
+        {
+          /* We're starting a new row */
+          column_count = 0;
+          row_count++;
+          if (options.list_data.limit && row_count >= options.list_data.limit)
             {
-              /* We're starting a new row */
-              column_count = 0;
-              row_count++;
-              if (options.list_data.limit && row_count >= options.list_data.limit)
-                {
-                  gtk_tree_model_get_iter_first (model, &iter);
-                  gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
-                }
-              gtk_list_store_append (GTK_LIST_STORE (model), &iter);
+              gtk_tree_model_get_iter_first (model, &iter);
+              gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
             }
+          gtk_list_store_append (GTK_LIST_STORE (model), &iter);
+        }
 
-          col = (YadColumn *) g_slist_nth_data (options.list_data.columns, column_count);
+      col = (YadColumn *) g_slist_nth_data (options.list_data.columns, column_count);
 
-          switch (col->type)
+      switch (col->type)
+        {
+        case YAD_COLUMN_CHECK:
+        case YAD_COLUMN_RADIO:
+          if (strcasecmp (line, "true") == 0)
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, TRUE, -1);
+          else
+            gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, FALSE, -1);
+          break;
+        case YAD_COLUMN_NUM:
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, g_ascii_strtoll (line, NULL, 10), -1);
+          break;
+        case YAD_COLUMN_FLOAT:
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, g_ascii_strtod (line, NULL), -1);
+          break;
+        case YAD_COLUMN_IMAGE:
+          pb = get_pixbuf (line, YAD_SMALL_ICON);
+          if (pb)
             {
-            case YAD_COLUMN_CHECK:
-            case YAD_COLUMN_RADIO:
-              if (strcasecmp (string->str, "true") == 0)
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, TRUE, -1);
-              else
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, FALSE, -1);
-              break;
-            case YAD_COLUMN_NUM:
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count,
-                                  g_ascii_strtoll (string->str, NULL, 10), -1);
-              break;
-            case YAD_COLUMN_FLOAT:
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, g_ascii_strtod (string->str, NULL), -1);
-              break;
-            case YAD_COLUMN_IMAGE:
-              pb = get_pixbuf (string->str, YAD_SMALL_ICON);
-              if (pb)
-                {
-                  gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, pb, -1);
-                  g_object_unref (pb);
-                }
-              break;
-            default:
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, string->str, -1);
-              break;
+              gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, pb, -1);
+              g_object_unref (pb);
             }
-
-          column_count++;
+          break;
+        default:
+          gtk_list_store_set (GTK_LIST_STORE (model), &iter, column_count, line, -1);
+          break;
         }
-      while (g_io_channel_get_buffer_condition (channel) == G_IO_IN);
-      g_string_free (string, TRUE);
-    }
 
-  if ((condition != G_IO_IN) && (condition != G_IO_IN + G_IO_HUP))
-    {
-      g_io_channel_shutdown (channel, TRUE, NULL);
-      return FALSE;
+      column_count++;
     }
-
-  return TRUE;
 }
 
 static void
@@ -441,7 +400,6 @@ fill_data (gint n_columns)
 {
   GtkTreeIter iter;
   GtkListStore *model = GTK_LIST_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (list_view)));
-  GIOChannel *channel;
 
   if (options.extra_data && *options.extra_data)
     {
@@ -506,13 +464,8 @@ fill_data (gint n_columns)
         }
     }
 
-  if (options.common_data.listen || !(options.extra_data && *options.extra_data))
-    {
-      channel = g_io_channel_unix_new (0);
-      g_io_channel_set_encoding (channel, NULL, NULL);
-      g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-      g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, GINT_TO_POINTER (n_columns));
-    }
+  if (options.common_data.listen || options.common_data.listen_socket || !(options.extra_data && *options.extra_data))
+    read_input (n_columns, NULL, handle_stdin, GINT_TO_POINTER (n_columns));
 }
 
 static void
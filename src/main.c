@@ -610,6 +610,9 @@ create_plug (void)
 void
 print_result (void)
 {
+  /* pending changes must go before the result */
+  flush_changes ();
+
   switch (options.mode)
     {
       case YAD_MODE_CALENDAR:
@@ -29,124 +29,89 @@
 static GSList *progress_bars = NULL;
 static guint nbars = 0;
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+/* bar number with # for comments, so the last value and the last comment of each bar are kept */
+static gchar *
+record_key (gchar * line)
+{
+  gchar *p = strchr (line, ':');
+
+  if (!p)
+    return NULL;
+  return g_strdup_printf ("%.*s%s", (gint) (p - line), line, p[1] == '#' ? "#" : "");
+}
+
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
 {
   float percentage = 0.0;
+  guint i;
 
-  if ((condition == G_IO_IN) || (condition == G_IO_IN + G_IO_HUP))
+  for (i = 0; i < n_lines; i++)
     {
-      GString *string;
       gchar **value;
-      GError *err = NULL;
-
-      string = g_string_new (NULL);
+      gint num;
+      GtkProgressBar *pb;
+      YadProgressBar *b;
 
-      while (channel->is_readable != TRUE);
-
-      do
+      value = g_strsplit (lines[i], ":", 2);
+      num = atoi (value[0]) - 1;
+      if (num < 0 || num > nbars - 1)
         {
-          gint status, num;
-          GtkProgressBar *pb;
-          YadProgressBar *b;
-
-          do
-            {
-              status = g_io_channel_read_line_string (channel, string, NULL, &err);
-
-              while (gtk_events_pending ())
-                gtk_main_iteration ();
+          g_strfreev (value);
+          continue;
+        }
 
-            }
-          while (status == G_IO_STATUS_AGAIN);
+      pb = GTK_PROGRESS_BAR (g_slist_nth_data (progress_bars, num));
+      b = (YadProgressBar *) g_slist_nth_data (options.multi_progress_data.bars, num);
 
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (err)
-                {
-                  g_printerr ("yad_multi_progress_handle_stdin(): %s\n", err->message);
-                  g_error_free (err);
-                  err = NULL;
-                }
-              /* stop handling */
-              g_io_channel_shutdown (channel, TRUE, NULL);
-              return FALSE;
-            }
-
-          value = g_strsplit (string->str, ":", 2);
-          num = atoi (value[0]) - 1;
-          if (num < 0 || num > nbars - 1)
-            continue;
+      if (value[1] && value[1][0] == '#')
+        {
+          gchar *match;
 
-          pb = GTK_PROGRESS_BAR (g_slist_nth_data (progress_bars, num));
-          b = (YadProgressBar *) g_slist_nth_data (options.multi_progress_data.bars, num);
+          /* We have a comment, so let's try to change the label */
+          match = g_strcompress (value[1] + 1);
+          gtk_progress_bar_set_text (pb, match);
+          g_free (match);
+        }
+      else if (value[1] && b->type == YAD_PROGRESS_PULSE)
+        gtk_progress_bar_pulse (pb);
+      else if (value[1] && g_ascii_isdigit (*value[1]))
+        {
+          /* Now try to convert the thing to a number */
+          percentage = atoi (value[1]);
+          if (percentage >= 100)
+            gtk_progress_bar_set_fraction (pb, 1.0);
+          else
+            gtk_progress_bar_set_fraction (pb, percentage / 100.0);
 
-          if (value[1] && value[1][0] == '#')
+          /* Check if all of progres bars reach 100% */
+          if (options.progress_data.autoclose && options.plug == -1)
             {
-              gchar *match, *p;
+              GSList *p;
+              gboolean close = TRUE;
 
-              /* We have a comment, so let's try to change the label */
-              match = g_strcompress (value[1] + 1);
-              p = g_strrstr (match, "\n");
-              if (p)
-                *p = '\0';
-              gtk_progress_bar_set_text (pb, match);
-              g_free (match);
-            }
-          else
-            {
-              if (value[1] && b->type == YAD_PROGRESS_PULSE)
-                gtk_progress_bar_pulse (pb);
-              else
+              for (p = progress_bars; p; p = p->next)
                 {
-                  if (!value[1] || !g_ascii_isdigit (*value[1]))
-                    continue;
-
-                  /* Now try to convert the thing to a number */
-                  percentage = atoi (value[1]);
-                  if (percentage >= 100)
-                    gtk_progress_bar_set_fraction (pb, 1.0);
-                  else
-                    gtk_progress_bar_set_fraction (pb, percentage / 100.0);
-
-                  /* Check if all of progres bars reach 100% */
-                  if (options.progress_data.autoclose && options.plug == -1)
+                  if (gtk_progress_bar_get_fraction (GTK_PROGRESS_BAR (p->data)) != 1.0)
                     {
-                      GSList *p;
-                      gboolean close = TRUE;
-
-                      for (p = progress_bars; p; p = p->next)
-                        {
-                          if (gtk_progress_bar_get_fraction (GTK_PROGRESS_BAR (p->data)) != 1.0)
-                            {
-                              close = FALSE;
-                              break;
-                            }
-                        }
-
-                      if (close)
-                        gtk_dialog_response (GTK_DIALOG (data), YAD_RESPONSE_OK);
+                      close = FALSE;
+                      break;
                     }
                 }
+
+              if (close)
+                gtk_dialog_response (GTK_DIALOG (data), YAD_RESPONSE_OK);
             }
         }
-      while (g_io_channel_get_buffer_condition (channel) == G_IO_IN);
-      g_string_free (string, TRUE);
-    }
 
-  if ((condition != G_IO_IN) && (condition != G_IO_IN + G_IO_HUP))
-    {
-      g_io_channel_shutdown (channel, TRUE, NULL);
-      return FALSE;
+      g_strfreev (value);
     }
-  return TRUE;
 }
 
 GtkWidget *
 multi_progress_create_widget (GtkWidget * dlg)
 {
   GtkWidget *table;
-  GIOChannel *channel;
   GSList *b;
   gint i = 0;
 
@@ -256,10 +221,7 @@ multi_progress_create_widget (GtkWidget * dlg)
       i++;
     }
 
-  channel = g_io_channel_unix_new (0);
-  g_io_channel_set_encoding (channel, NULL, NULL);
-  g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-  g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, dlg);
+  read_input (1, record_key, handle_stdin, dlg);
 
   return table;
 }
@@ -141,7 +141,7 @@ icon_size_changed_cb (GtkStatusIcon * icon, gint size, gpointer data)
 static gboolean
 activate_cb (GtkWidget * widget, YadData * data)
 {
-  if ((action == NULL && !options.common_data.listen) || (action && g_ascii_strcasecmp (action, "quit") == 0))
+  if ((action == NULL && !options.common_data.listen && !options.common_data.listen_socket) || (action && g_ascii_strcasecmp (action, "quit") == 0))
     {
       exit_code = YAD_RESPONSE_OK;
       gtk_main_quit ();
@@ -228,144 +228,126 @@ popup_menu_cb (GtkStatusIcon * icon, guint button, guint activate_time, gpointer
   gtk_menu_popup (GTK_MENU (menu), NULL, NULL, gtk_status_icon_position_menu, icon, button, activate_time);
 }
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+/* commands which set a state, so only the last of them is needed. visible may toggle blinking */
+static gchar *
+record_key (gchar * line)
 {
-  if ((condition & G_IO_IN) != 0)
-    {
-      GString *string;
-      GError *err = NULL;
+  static const gchar *cmds[] = { "icon", "tooltip", "action", "menu", NULL };
+  gchar *p = strchr (line, ':');
+  gchar *cmd;
+  guint i;
 
-      string = g_string_new (NULL);
-      while (channel->is_readable == FALSE);
+  if (!p)
+    return NULL;
 
-      do
-        {
-          gint status;
-          gchar *command = NULL, *value = NULL, **args;
+  cmd = g_ascii_strdown (line, p - line);
+  for (i = 0; cmds[i]; i++)
+    {
+      if (strcmp (cmd, cmds[i]) == 0)
+        return cmd;
+    }
+  g_free (cmd);
 
-          do
-            {
-              status = g_io_channel_read_line_string (channel, string, NULL, &err);
+  return NULL;
+}
 
-              while (gdk_events_pending ())
-                gtk_main_iteration ();
-            }
-          while (status == G_IO_STATUS_AGAIN);
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
+{
+  guint i;
 
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (err)
-                {
-                  g_printerr ("yad_notification_handle_stdin(): %s\n", err->message);
-                  g_error_free (err);
-                  err = NULL;
-                }
-              /* stop handling but not exit */
-              g_io_channel_shutdown (channel, TRUE, NULL);
-              return FALSE;
-            }
+  for (i = 0; i < n_lines; i++)
+    {
+      gchar *command = NULL, *value = NULL, **args;
 
-          strip_new_line (string->str);
-          if (!string->str[0])
-            continue;
+      if (!lines[i][0])
+        continue;
 
-          args = g_strsplit (string->str, ":", 2);
-          command = g_strdup (args[0]);
-          if (args[1])
-            value = g_strdup (args[1]);
-          g_strfreev (args);
-          if (value)
-            g_strstrip (value);
+      args = g_strsplit (lines[i], ":", 2);
+      command = g_strdup (args[0]);
+      if (args[1])
+        value = g_strdup (args[1]);
+      g_strfreev (args);
+      if (value)
+        g_strstrip (value);
 
-          if (!g_ascii_strcasecmp (command, "icon") && value)
-            {
-              g_free (icon);
-              icon = g_strdup (value);
+      if (!g_ascii_strcasecmp (command, "icon") && value)
+        {
+          g_free (icon);
+          icon = g_strdup (value);
 
-              if (gtk_status_icon_get_visible (status_icon) && gtk_status_icon_is_embedded (status_icon))
-                set_icon ();
-            }
-          else if (!g_ascii_strcasecmp (command, "tooltip"))
+          if (gtk_status_icon_get_visible (status_icon) && gtk_status_icon_is_embedded (status_icon))
+            set_icon ();
+        }
+      else if (!g_ascii_strcasecmp (command, "tooltip"))
+        {
+          if (g_utf8_validate (value, -1, NULL))
             {
-              if (g_utf8_validate (value, -1, NULL))
-                {
-                  gchar *message = g_strcompress (value);
-                  if (!options.data.no_markup)
-                    gtk_status_icon_set_tooltip_markup (status_icon, message);
-                  else
-                    gtk_status_icon_set_tooltip_text (status_icon, message);
-                  g_free (message);
-                }
+              gchar *message = g_strcompress (value);
+              if (!options.data.no_markup)
+                gtk_status_icon_set_tooltip_markup (status_icon, message);
               else
-                g_printerr (_("Invalid UTF-8 in tooltip!\n"));
+                gtk_status_icon_set_tooltip_text (status_icon, message);
+              g_free (message);
             }
-          else if (!g_ascii_strcasecmp (command, "visible"))
-            {
-#if !GTK_CHECK_VERSION(2,22,0)
-              if (!g_ascii_strcasecmp (value, "blink"))
-                {
-                  gboolean state = gtk_status_icon_get_blinking (status_icon);
-                  gtk_status_icon_set_blinking (status_icon, !state);
-                }
-              else
-#endif
-              if (!g_ascii_strcasecmp (value, "false"))
-                {
-                  gtk_status_icon_set_visible (status_icon, FALSE);
-#if !GTK_CHECK_VERSION(2,22,0)
-                  gtk_status_icon_set_blinking (status_icon, FALSE);
-#endif
-                }
-              else
-                {
-                  gtk_status_icon_set_visible (status_icon, TRUE);
+          else
+            g_printerr (_("Invalid UTF-8 in tooltip!\n"));
+        }
+      else if (!g_ascii_strcasecmp (command, "visible"))
+        {
 #if !GTK_CHECK_VERSION(2,22,0)
-                  gtk_status_icon_set_blinking (status_icon, FALSE);
-#endif
-                }
-            }
-          else if (!g_ascii_strcasecmp (command, "action"))
+          if (!g_ascii_strcasecmp (value, "blink"))
             {
-              g_free (action);
-              if (value)
-                action = g_strdup (value);
+              gboolean state = gtk_status_icon_get_blinking (status_icon);
+              gtk_status_icon_set_blinking (status_icon, !state);
             }
-          else if (!g_ascii_strcasecmp (command, "quit"))
+          else
+#endif
+          if (!g_ascii_strcasecmp (value, "false"))
             {
-              exit_code = YAD_RESPONSE_OK;
-              gtk_main_quit ();
+              gtk_status_icon_set_visible (status_icon, FALSE);
+#if !GTK_CHECK_VERSION(2,22,0)
+              gtk_status_icon_set_blinking (status_icon, FALSE);
+#endif
             }
-          else if (!g_ascii_strcasecmp (command, "menu"))
+          else
             {
-              if (value)
-                parse_menu_str (value);
+              gtk_status_icon_set_visible (status_icon, TRUE);
+#if !GTK_CHECK_VERSION(2,22,0)
+              gtk_status_icon_set_blinking (status_icon, FALSE);
+#endif
             }
-          else
-            g_printerr (_("Unknown command '%s'\n"), command);
-
-          g_free (command);
-          g_free (value);
         }
-      while (g_io_channel_get_buffer_condition (channel) == G_IO_IN);
-      g_string_free (string, TRUE);
-    }
+      else if (!g_ascii_strcasecmp (command, "action"))
+        {
+          g_free (action);
+          if (value)
+            action = g_strdup (value);
+        }
+      else if (!g_ascii_strcasecmp (command, "quit"))
+        {
+          exit_code = YAD_RESPONSE_OK;
+          gtk_main_quit ();
+        }
+      else if (!g_ascii_strcasecmp (command, "menu"))
+        {
+          if (value)
+            parse_menu_str (value);
+        }
+      else
+        g_printerr (_("Unknown command '%s'\n"), command);
 
-  if ((condition & G_IO_HUP) != 0)
-    {
-      g_io_channel_shutdown (channel, TRUE, NULL);
-      gtk_main_quit ();
-      return FALSE;
+      g_free (command);
+      g_free (value);
     }
 
-  return TRUE;
+  if (eof)
+    gtk_main_quit ();
 }
 
 gint
 yad_notification_run ()
 {
-  GIOChannel *channel = NULL;
-
   status_icon = gtk_status_icon_new ();
   g_signal_connect (status_icon, "size-changed", G_CALLBACK (icon_size_changed_cb), NULL);
 
@@ -396,16 +378,8 @@ yad_notification_run ()
   if (options.notification_data.middle)
     g_signal_connect (status_icon, "button-press-event", G_CALLBACK (middle_quit_cb), NULL);
 
-  if (options.common_data.listen)
-    {
-      channel = g_io_channel_unix_new (0);
-      if (channel)
-        {
-          g_io_channel_set_encoding (channel, NULL, NULL);
-          g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-          g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, NULL);
-        }
-    }
+  if (options.common_data.listen || options.common_data.listen_socket)
+    read_input (1, record_key, handle_stdin, NULL);
 
   /* Show icon and wait */
   gtk_status_icon_set_visible (status_icon, !options.notification_data.hidden);
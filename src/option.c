@@ -46,6 +46,11 @@ static gboolean set_progress_log (const gchar *, const gchar *, gpointer, GError
 static gboolean parse_signal (const gchar *, const gchar *, gpointer, GError **);
 #endif
 static gboolean add_image_path (const gchar *, const gchar *, gpointer, GError **);
+static gboolean set_backpressure (const gchar *, const gchar *, gpointer, GError **);
+static gboolean set_high_water (const gchar *, const gchar *, gpointer, GError **);
+static gboolean set_icon_timeout (const gchar *, const gchar *, gpointer, GError **);
+static gboolean set_print_changes (const gchar *, const gchar *, gpointer, GError **);
+static gboolean set_export_dir (const gchar *, const gchar *, gpointer, GError **);
 
 static gboolean about_mode = FALSE;
 static gboolean version_mode = FALSE;
@@ -290,6 +295,18 @@ static GOptionEntry general_options[] = {
    add_image_path,
    N_("Add path for search icons by name"),
    N_("PATH")},
+  {"backpressure", 0,
+   0,
+   G_OPTION_ARG_CALLBACK,
+   set_backpressure,
+   N_("Set behavior on input overflow (block, drop-oldest, drop-newest or coalesce). coalesce works as drop-oldest in list, icons and text dialogs"),
+   N_("TYPE")},
+  {"high-water", 0,
+   0,
+   G_OPTION_ARG_CALLBACK,
+   set_high_water,
+   N_("Set maximum number of queued input records"),
+   N_("NUMBER")},
   {NULL}
 };
 
@@ -330,6 +347,12 @@ static GOptionEntry calendar_options[] = {
    &options.calendar_data.details,
    N_("Set the filename with dates details"),
    N_("FILENAME")},
+  {"details-command", 0,
+   0,
+   G_OPTION_ARG_STRING,
+   &options.calendar_data.details_cmd,
+   N_("Get dates details of each month from command"),
+   N_("CMD")},
   {NULL}
 };
 
@@ -388,6 +411,12 @@ static GOptionEntry color_options[] = {
    &options.color_data.alpha,
    N_("Add opacity to output color value"),
    NULL},
+  {"print-changes", 0,
+   G_OPTION_FLAG_OPTIONAL_ARG | G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_CALLBACK,
+   set_print_changes,
+   N_("Print changed values not more often than once per MS milliseconds"),
+   N_("MS")},
   {NULL}
 };
 
@@ -444,6 +473,18 @@ static GOptionEntry entry_options[] = {
    &options.entry_data.completion,
    N_("Use completion instead of combo-box"),
    NULL},
+  {"completion-command", 0,
+   0,
+   G_OPTION_ARG_STRING,
+   &options.entry_data.completion_cmd,
+   N_("Get completion items from output of command"),
+   N_("CMD")},
+  {"fuzzy", 0,
+   0,
+   G_OPTION_ARG_NONE,
+   &options.entry_data.fuzzy,
+   N_("Use fuzzy matching for completion"),
+   NULL},
   {"numeric", 0,
    0,
    G_OPTION_ARG_NONE,
@@ -480,6 +521,18 @@ static GOptionEntry entry_options[] = {
    &options.entry_data.ricon_action,
    N_("Set the right entry icon action"),
    N_("CMD")},
+  {"icon-timeout", 0,
+   0,
+   G_OPTION_ARG_CALLBACK,
+   set_icon_timeout,
+   N_("Cancel icon action after SECONDS"),
+   N_("SECONDS")},
+  {"print-changes", 0,
+   G_OPTION_FLAG_OPTIONAL_ARG | G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_CALLBACK,
+   set_print_changes,
+   N_("Print changed values not more often than once per MS milliseconds"),
+   N_("MS")},
   {NULL}
 };
 
@@ -631,6 +684,24 @@ static GOptionEntry form_options[] = {
    &options.form_data.output_by_row,
    N_("Order output fields by rows"),
    NULL},
+  {"large-lists", 0,
+   0,
+   G_OPTION_ARG_NONE,
+   &options.form_data.large_lists,
+   N_("Allow items from files and commands and show large lists as entries with completion"),
+   NULL},
+  {"listen", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_NONE,
+   &options.common_data.listen,
+   N_("Read new values of fields from stdin"),
+   NULL},
+  {"print-changes", 0,
+   G_OPTION_FLAG_OPTIONAL_ARG | G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_CALLBACK,
+   set_print_changes,
+   N_("Print changed values not more often than once per MS milliseconds"),
+   N_("MS")},
   {NULL}
 };
 
@@ -887,6 +958,12 @@ static GOptionEntry list_options[] = {
    &options.common_data.quoted_output,
    N_("Quote dialogs output"),
    NULL},
+  {"listen-socket", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_FILENAME,
+   &options.common_data.listen_socket,
+   N_("Read data from clients of UNIX socket instead of stdin"),
+   N_("PATH")},
   {NULL}
 };
 
@@ -930,6 +1007,12 @@ static GOptionEntry multi_progress_options[] = {
    N_("Kill parent process if cancel button is pressed"),
    NULL},
 #endif
+  {"listen-socket", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_FILENAME,
+   &options.common_data.listen_socket,
+   N_("Read data from clients of UNIX socket instead of stdin"),
+   N_("PATH")},
   {NULL}
 };
 
@@ -1016,6 +1099,12 @@ static GOptionEntry notification_options[] = {
    &options.notification_data.hidden,
    N_("Doesn't show icon at startup"),
    NULL},
+  {"listen-socket", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_FILENAME,
+   &options.common_data.listen_socket,
+   N_("Read data from clients of UNIX socket instead of stdin"),
+   N_("PATH")},
   {NULL}
 };
 
@@ -1084,6 +1173,18 @@ static GOptionEntry print_options[] = {
    &options.common_data.font,
    N_("Use specified font"),
    N_("FONTNAME")},
+  {"fast-scale", 0,
+   0,
+   G_OPTION_ARG_NONE,
+   &options.print_data.fast_scale,
+   N_("Scale image by cairo instead of resampling"),
+   NULL},
+  {"export", 0,
+   G_OPTION_FLAG_OPTIONAL_ARG,
+   G_OPTION_ARG_CALLBACK,
+   set_export_dir,
+   N_("Export files to PDF without dialog"),
+   N_("DIR")},
   {NULL}
 };
 
@@ -1157,6 +1258,12 @@ static GOptionEntry progress_options[] = {
    &options.progress_data.log_height,
    N_("Height of log window"),
    NULL},
+  {"listen-socket", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_FILENAME,
+   &options.common_data.listen_socket,
+   N_("Read data from clients of UNIX socket instead of stdin"),
+   N_("PATH")},
   {NULL}
 };
 
@@ -1227,6 +1334,12 @@ static GOptionEntry scale_options[] = {
    add_scale_mark,
    N_("Add mark to scale (may be used multiple times)"),
    N_("NAME:VALUE")},
+  {"print-changes", 0,
+   G_OPTION_FLAG_OPTIONAL_ARG | G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_CALLBACK,
+   set_print_changes,
+   N_("Print changed values not more often than once per MS milliseconds"),
+   N_("MS")},
   {NULL}
 };
 
@@ -1309,6 +1422,12 @@ static GOptionEntry text_options[] = {
    &options.common_data.listen,
    N_("Listen for data on stdin in addition to file"),
    NULL},
+  {"listen-socket", 0,
+   G_OPTION_FLAG_NOALIAS,
+   G_OPTION_ARG_FILENAME,
+   &options.common_data.listen_socket,
+   N_("Read data from clients of UNIX socket instead of stdin"),
+   N_("PATH")},
   {NULL}
 };
 
@@ -1466,9 +1585,31 @@ add_field (const gchar * option_name, const gchar * value, gpointer data, GError
   gchar **fstr = split_arg (value);
 
   fld = g_new0 (YadField, 1);
+  if (!fstr[1])
+    {
+      /* field id without type goes after the label. label itself may contain @,
+       * so only a name of letters, digits, _ and - is treated as id */
+      gchar *id = strrchr (fstr[0], '@');
+
+      if (id && id[1] && id[1 + strspn (id + 1, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-")] == '\0')
+        {
+          *id = '\0';
+          fld->id = g_strdup (id + 1);
+        }
+    }
   fld->name = g_strdup (fstr[0]);
   if (fstr[1])
     {
+      /* optional field id goes after the type */
+      gchar *id = strchr (fstr[1], '@');
+
+      if (id)
+        {
+          *id = '\0';
+          if (id[1])
+            fld->id = g_strdup (id + 1);
+        }
+
       if (strcasecmp (fstr[1], "H") == 0)
         fld->type = YAD_FIELD_HIDDEN;
       else if (strcasecmp (fstr[1], "RO") == 0)
@@ -1828,6 +1969,88 @@ add_image_path (const gchar * option_name, const gchar * value, gpointer data, G
   return TRUE;
 }
 
+static gboolean
+set_backpressure (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
+{
+  if (strcasecmp (value, "block") == 0)
+    options.common_data.backpressure = YAD_BACKPRESSURE_BLOCK;
+  else if (strcasecmp (value, "drop-oldest") == 0)
+    options.common_data.backpressure = YAD_BACKPRESSURE_DROP_OLDEST;
+  else if (strcasecmp (value, "drop-newest") == 0)
+    options.common_data.backpressure = YAD_BACKPRESSURE_DROP_NEWEST;
+  else if (strcasecmp (value, "coalesce") == 0)
+    options.common_data.backpressure = YAD_BACKPRESSURE_COALESCE;
+  else
+    g_printerr (_("Unknown backpressure type: %s\n"), value);
+
+  return TRUE;
+}
+
+/* parse a number which must be greater than zero. returns -1 on wrong value */
+static gint
+parse_positive (const gchar * option_name, const gchar * value)
+{
+  gchar *end;
+  gint64 n;
+
+  n = g_ascii_strtoll (value, &end, 10);
+  if (*value == '\0' || *end != '\0' || n <= 0 || n > G_MAXINT)
+    {
+      g_printerr (_("Wrong value of %s: %s\n"), option_name, value);
+      return -1;
+    }
+
+  return (gint) n;
+}
+
+static gboolean
+set_high_water (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
+{
+  gint n = parse_positive (option_name, value);
+
+  if (n > 0)
+    options.common_data.high_water = n;
+
+  return TRUE;
+}
+
+static gboolean
+set_icon_timeout (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
+{
+  gint n = parse_positive (option_name, value);
+
+  if (n > 0)
+    options.entry_data.icon_timeout = n;
+
+  return TRUE;
+}
+
+static gboolean
+set_print_changes (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
+{
+  options.common_data.print_changes = TRUE;
+  if (value)
+    {
+      gchar *end;
+      guint64 ms = g_ascii_strtoull (value, &end, 10);
+
+      /* zero means printing of each change without throttling */
+      if (!g_ascii_isdigit (value[0]) || *end || ms > G_MAXINT)
+        g_printerr (_("Wrong value of %s: %s\n"), option_name, value);
+      else
+        options.common_data.changes_interval = (guint) ms;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+set_export_dir (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
+{
+  options.print_data.export_dir = g_strdup (value ? value : ".");
+  return TRUE;
+}
+
 #ifndef G_OS_WIN32
 static gboolean
 parse_signal (const gchar * option_name, const gchar * value, gpointer data, GError ** err)
@@ -2039,6 +2262,11 @@ yad_options_init (void)
   options.common_data.vertical = FALSE;
   options.common_data.align = 0.0;
   options.common_data.listen = FALSE;
+  options.common_data.listen_socket = NULL;
+  options.common_data.print_changes = FALSE;
+  options.common_data.changes_interval = 200;
+  options.common_data.backpressure = YAD_BACKPRESSURE_BLOCK;
+  options.common_data.high_water = 0;
   options.common_data.preview = FALSE;
   options.common_data.quoted_output = FALSE;
   options.common_data.filters = NULL;
@@ -2049,6 +2277,7 @@ yad_options_init (void)
   options.calendar_data.month = -1;
   options.calendar_data.year = -1;
   options.calendar_data.details = NULL;
+  options.calendar_data.details_cmd = NULL;
 
   /* Initialize color data */
   options.color_data.init_color = NULL;
@@ -2068,11 +2297,14 @@ yad_options_init (void)
   options.entry_data.entry_label = NULL;
   options.entry_data.hide_text = FALSE;
   options.entry_data.completion = FALSE;
+  options.entry_data.completion_cmd = NULL;
+  options.entry_data.fuzzy = FALSE;
   options.entry_data.numeric = FALSE;
   options.entry_data.licon = NULL;
   options.entry_data.licon_action = NULL;
   options.entry_data.ricon = NULL;
   options.entry_data.ricon_action = NULL;
+  options.entry_data.icon_timeout = 0;
 
   /* Initialize file data */
   options.file_data.directory = FALSE;
@@ -2091,6 +2323,7 @@ yad_options_init (void)
   options.form_data.columns = 1;
   options.form_data.scroll = FALSE;
   options.form_data.output_by_row = FALSE;
+  options.form_data.large_lists = FALSE;
 
 #ifdef HAVE_HTML
   /* Initialize html data */
@@ -2151,6 +2384,8 @@ yad_options_init (void)
   /* Initialize print data */
   options.print_data.type = YAD_PRINT_TEXT;
   options.print_data.headers = FALSE;
+  options.print_data.fast_scale = FALSE;
+  options.print_data.export_dir = NULL;
 
   /* Initialize progress data */
   options.progress_data.progress_text = NULL;
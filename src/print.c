@@ -19,6 +19,8 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include <string.h>
+#include <errno.h>
 
 #include <gtk/gtkunixprint.h>
 
@@ -31,51 +33,90 @@
 #define FONTNAME "Sans"
 #define FONTSIZE 12.0
 
-static gchar **text;
-static gint nlines, npages;
+/* minimal size of text part measured by one worker job */
+#define TEXT_CHUNK (256 * 1024)
+
+/* measured lines of text part. consecutive unwrapped lines of the same height are joined */
+typedef struct {
+  gsize offset;
+  guint count;
+  gdouble height;
+  gboolean wrapped;
+} YadTextRun;
+
+typedef struct {
+  gsize start;
+  gsize end;
+  GArray *runs;
+  gboolean done;
+} YadTextChunk;
+
+static GMappedFile *text_map = NULL;
+static const gchar *text;
+static gsize text_size;
+
+static PangoLayout *text_layout = NULL;
+/* offsets of page starts */
+static GArray *pages = NULL;
+static gint npages;
+
+/* state of pagination */
+static GThreadPool *text_pool = NULL;
+static GAsyncQueue *text_results = NULL;
+static GPtrArray *text_chunks = NULL;
+static guint text_merged;
+/* stops measuring when printing is finished before the end of pagination */
+static volatile gint text_cancel = 0;
+static gdouble text_y;
+static gdouble text_top, text_width, text_height;
+static gdouble text_resolution;
 
 static PangoFontDescription *fdesc = NULL;
 
+/* header layouts are the same for all pages except of page number */
+static PangoLayout *title_layout = NULL;
+static PangoLayout *page_layout = NULL;
+
 static void
 draw_header (GtkPrintContext * cnt, gint pn, gint pc)
 {
   cairo_t *cr;
-  PangoFontDescription *desc;
-  PangoLayout *layout;
   gint pw, tw, th;
   gchar *page;
 
   cr = gtk_print_context_get_cairo_context (cnt);
   pw = gtk_print_context_get_width (cnt);
 
-  layout = gtk_print_context_create_pango_layout (cnt);
+  if (!title_layout)
+    {
+      PangoFontDescription *desc = pango_font_description_from_string (HEADER_FONT);
 
-  desc = pango_font_description_from_string (HEADER_FONT);
-  pango_layout_set_font_description (layout, desc);
-  pango_font_description_free (desc);
+      title_layout = gtk_print_context_create_pango_layout (cnt);
+      pango_layout_set_font_description (title_layout, desc);
+      pango_layout_set_text (title_layout, options.common_data.uri, -1);
+      pango_layout_get_pixel_size (title_layout, &tw, &th);
+      if (tw > pw)
+        {
+          pango_layout_set_width (title_layout, pw * PANGO_SCALE);
+          pango_layout_set_ellipsize (title_layout, PANGO_ELLIPSIZE_START);
+        }
 
-  pango_layout_set_text (layout, options.common_data.uri, -1);
-  pango_layout_get_pixel_size (layout, &tw, &th);
-  if (tw > pw)
-    {
-      pango_layout_set_width (layout, pw);
-      pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_START);
-      pango_layout_get_pixel_size (layout, &tw, &th);
+      page_layout = gtk_print_context_create_pango_layout (cnt);
+      pango_layout_set_font_description (page_layout, desc);
+      pango_font_description_free (desc);
     }
 
+  pango_layout_get_pixel_size (title_layout, &tw, &th);
   cairo_move_to (cr, (pw - tw) / 2, (HEADER_HEIGHT - th) / 2);
-  pango_cairo_show_layout (cr, layout);
+  pango_cairo_show_layout (cr, title_layout);
 
   page = g_strdup_printf ("%d/%d", pn, pc);
-  pango_layout_set_text (layout, page, -1);
+  pango_layout_set_text (page_layout, page, -1);
   g_free (page);
 
-  pango_layout_set_width (layout, -1);
-  pango_layout_get_pixel_size (layout, &tw, &th);
+  pango_layout_get_pixel_size (page_layout, &tw, &th);
   cairo_move_to (cr, pw - tw - 4, (HEADER_HEIGHT - th) / 2);
-  pango_cairo_show_layout (cr, layout);
-
-  g_object_unref (layout);
+  pango_cairo_show_layout (cr, page_layout);
 
   cairo_move_to (cr, 0.0, HEADER_HEIGHT);
   cairo_line_to (cr, pw, HEADER_HEIGHT);
@@ -85,28 +126,125 @@ draw_header (GtkPrintContext * cnt, gint pn, gint pc)
   cairo_stroke (cr);
 }
 
+/* get text line at offset. returns its length without newline */
+static gsize
+get_text_line (gsize offset)
+{
+  const gchar *end = memchr (text + offset, '\n', text_size - offset);
+
+  return end ? (gsize) (end - text - offset) : text_size - offset;
+}
+
 static void
-begin_print_text (GtkPrintOperation * op, GtkPrintContext * cnt, gpointer data)
+add_run (GArray * runs, gsize offset, gdouble height, gboolean wrapped)
 {
-  gchar *buf;
-  gint i = 0;
-  gdouble ph;
+  YadTextRun *last = runs->len ? &g_array_index (runs, YadTextRun, runs->len - 1) : NULL;
+  YadTextRun run;
 
-  /* load file */
-  g_file_get_contents (options.common_data.uri, &buf, NULL, NULL);
-  text = g_strsplit (buf, "\n", 0);
-  g_free (buf);
+  if (!wrapped && last && !last->wrapped && last->height == height)
+    {
+      last->count++;
+      return;
+    }
 
-  while (text[i] != NULL)
-    i++;
+  run.offset = offset;
+  run.count = 1;
+  run.height = height;
+  run.wrapped = wrapped;
+  g_array_append_val (runs, run);
+}
 
-  ph = gtk_print_context_get_height (cnt);
-  if (options.print_data.headers)
-    ph -= HEADER_HEIGHT + HEADER_GAP;
+/* measure lines of text part. works in thread pool, so it uses its own font map */
+static void
+measure_text_func (gpointer data, gpointer user_data)
+{
+  YadTextChunk *ch = (YadTextChunk *) data;
+  PangoFontMap *fm;
+  PangoContext *ctx;
+  PangoLayout *layout;
+  cairo_font_options_t *fo;
+  gsize pos;
+
+  /* same settings as in pango context of print operation */
+  fm = pango_cairo_font_map_new ();
+  ctx = pango_font_map_create_context (fm);
+  pango_cairo_context_set_resolution (ctx, text_resolution);
+  fo = cairo_font_options_create ();
+  cairo_font_options_set_hint_metrics (fo, CAIRO_HINT_METRICS_OFF);
+  pango_cairo_context_set_font_options (ctx, fo);
+  cairo_font_options_destroy (fo);
+
+  layout = pango_layout_new (ctx);
+  pango_layout_set_font_description (layout, fdesc);
+  pango_layout_set_width (layout, text_width * PANGO_SCALE);
+  pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
 
-  nlines = ph / FONTSIZE;
-  npages = i / nlines + 1;
-  gtk_print_operation_set_n_pages (op, npages);
+  for (pos = ch->start; pos < ch->end && !g_atomic_int_get (&text_cancel); pos += get_text_line (pos) + 1)
+    {
+      PangoRectangle rect;
+
+      pango_layout_set_text (layout, text + pos, get_text_line (pos));
+      if (pango_layout_get_line_count (layout) == 1)
+        {
+          pango_layout_get_extents (layout, NULL, &rect);
+          add_run (ch->runs, pos, (gdouble) rect.height / PANGO_SCALE, FALSE);
+        }
+      else
+        {
+          /* each wrapped line may start a page */
+          PangoLayoutIter *iter = pango_layout_get_iter (layout);
+
+          do
+            {
+              pango_layout_iter_get_line_extents (iter, NULL, &rect);
+              add_run (ch->runs, pos + pango_layout_iter_get_index (iter), (gdouble) rect.height / PANGO_SCALE, TRUE);
+            }
+          while (pango_layout_iter_next_line (iter));
+          pango_layout_iter_free (iter);
+        }
+    }
+
+  g_object_unref (layout);
+  g_object_unref (ctx);
+  g_object_unref (fm);
+
+  g_async_queue_push (text_results, ch);
+}
+
+static void
+free_text_chunk (YadTextChunk * ch)
+{
+  g_array_free (ch->runs, TRUE);
+  g_free (ch);
+}
+
+static void
+begin_print_text (GtkPrintOperation * op, GtkPrintContext * cnt, gpointer data)
+{
+  GError *err = NULL;
+  gsize pos, size;
+  guint nt;
+
+  /* file is mapped, so only pages in use are loaded */
+  text_map = g_mapped_file_new (options.common_data.uri, FALSE, &err);
+  if (!text_map)
+    {
+      g_printerr (_("Cannot open file '%s': %s\n"), options.common_data.uri, err->message);
+      g_error_free (err);
+      gtk_print_operation_cancel (op);
+      return;
+    }
+  text = g_mapped_file_get_contents (text_map);
+  text_size = g_mapped_file_get_length (text_map);
+
+  text_top = 0;
+  text_width = gtk_print_context_get_width (cnt);
+  text_height = gtk_print_context_get_height (cnt);
+  if (options.print_data.headers)
+    {
+      text_top = HEADER_HEIGHT + HEADER_GAP;
+      text_height -= text_top;
+    }
 
   /* set font */
   if (options.common_data.font)
@@ -116,14 +254,119 @@ begin_print_text (GtkPrintOperation * op, GtkPrintContext * cnt, gpointer data)
       fdesc = pango_font_description_from_string (FONTNAME);
       pango_font_description_set_size (fdesc, FONTSIZE * PANGO_SCALE);
     }
+
+  /* one layout is used for drawing all pages. long lines are wrapped */
+  text_layout = gtk_print_context_create_pango_layout (cnt);
+  pango_layout_set_font_description (text_layout, fdesc);
+  pango_layout_set_width (text_layout, text_width * PANGO_SCALE);
+  pango_layout_set_wrap (text_layout, PANGO_WRAP_WORD_CHAR);
+  text_resolution = pango_cairo_context_get_resolution (pango_layout_get_context (text_layout));
+
+  pages = g_array_new (FALSE, FALSE, sizeof (gsize));
+  pos = 0;
+  g_array_append_val (pages, pos);
+  npages = 0;
+  text_y = 0;
+
+  /* split text by lines into parts for measuring in parallel */
+  nt = g_get_num_processors ();
+  size = MAX (TEXT_CHUNK, text_size / (nt * 4));
+  text_chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) free_text_chunk);
+  text_results = g_async_queue_new ();
+  g_atomic_int_set (&text_cancel, 0);
+  text_pool = g_thread_pool_new (measure_text_func, NULL, nt, FALSE, NULL);
+  text_merged = 0;
+  while (pos < text_size)
+    {
+      YadTextChunk *ch = g_new0 (YadTextChunk, 1);
+
+      ch->start = pos;
+      ch->end = MIN (pos + size, text_size);
+      if (ch->end < text_size)
+        ch->end += get_text_line (ch->end) + 1;
+      ch->end = MIN (ch->end, text_size);
+      ch->runs = g_array_new (FALSE, FALSE, sizeof (YadTextRun));
+      g_ptr_array_add (text_chunks, ch);
+      g_thread_pool_push (text_pool, ch, NULL);
+      pos = ch->end;
+    }
+}
+
+/* find page breaks in measured lines */
+static void
+merge_text_chunk (YadTextChunk * ch)
+{
+  guint i, j;
+
+  for (i = 0; i < ch->runs->len; i++)
+    {
+      YadTextRun *run = &g_array_index (ch->runs, YadTextRun, i);
+      gsize pos = run->offset;
+
+      for (j = 0; j < run->count; j++)
+        {
+          if (text_y + run->height > text_height && text_y > 0)
+            {
+              g_array_append_val (pages, pos);
+              text_y = 0;
+            }
+          text_y += run->height;
+          if (!run->wrapped)
+            pos += get_text_line (pos) + 1;
+        }
+    }
+
+  /* runs are not needed anymore */
+  g_array_set_size (ch->runs, 0);
+}
+
+static gboolean
+paginate_text (GtkPrintOperation * op, GtkPrintContext * cnt, gpointer data)
+{
+  YadTextChunk *ch;
+
+  if (!pages)
+    return TRUE;
+
+  /* wait for measured parts not long, for keeping dialog responsive */
+  ch = g_async_queue_timeout_pop (text_results, 10000);
+  while (ch)
+    {
+      ch->done = TRUE;
+      ch = g_async_queue_try_pop (text_results);
+    }
+
+  /* parts are merged in order */
+  while (text_merged < text_chunks->len)
+    {
+      ch = g_ptr_array_index (text_chunks, text_merged);
+      if (!ch->done)
+        break;
+      merge_text_chunk (ch);
+      text_merged++;
+    }
+
+  if (text_merged < text_chunks->len)
+    {
+      /* publish pages found so far. the last one may still grow, so it is not counted */
+      if ((gint) pages->len - 1 > npages)
+        {
+          npages = pages->len - 1;
+          gtk_print_operation_set_n_pages (op, npages);
+        }
+      return FALSE;
+    }
+
+  npages = pages->len;
+  gtk_print_operation_set_n_pages (op, npages);
+  return TRUE;
 }
 
 static void
 draw_page_text (GtkPrintOperation * op, GtkPrintContext * cnt, gint page, gpointer data)
 {
   cairo_t *cr;
-  PangoLayout *layout;
-  gint i, line;
+  gsize start, end;
 
   cr = gtk_print_context_get_cairo_context (cnt);
 
@@ -131,64 +374,309 @@ draw_page_text (GtkPrintOperation * op, GtkPrintContext * cnt, gint page, gpoint
   if (options.print_data.headers)
     draw_header (cnt, page + 1, npages);
 
-  /* add text */
-  layout = gtk_print_context_create_pango_layout (cnt);
-  pango_layout_set_font_description (layout, fdesc);
+  /* whole page is one layout */
+  start = g_array_index (pages, gsize, page);
+  end = (page + 1 < pages->len) ? g_array_index (pages, gsize, page + 1) : text_size;
+  if (end > start && text[end - 1] == '\n')
+    end--;
+
+  pango_layout_set_text (text_layout, text + start, end - start);
+  cairo_move_to (cr, 0, text_top);
+  pango_cairo_show_layout (cr, text_layout);
+}
+
+static void
+end_print (GtkPrintOperation * op, GtkPrintContext * cnt, gpointer data)
+{
+  if (title_layout)
+    {
+      g_object_unref (title_layout);
+      g_object_unref (page_layout);
+    }
+  title_layout = page_layout = NULL;
+
+  if (text_pool)
+    {
+      /* pool may be still working if printing was cancelled. queued parts are dropped,
+       * running ones stop at the next line */
+      g_atomic_int_set (&text_cancel, 1);
+      g_thread_pool_free (text_pool, TRUE, TRUE);
+      g_async_queue_unref (text_results);
+      g_ptr_array_free (text_chunks, TRUE);
+    }
+  text_pool = NULL;
+  if (text_layout)
+    g_object_unref (text_layout);
+  text_layout = NULL;
+  if (pages)
+    g_array_free (pages, TRUE);
+  pages = NULL;
+  if (fdesc)
+    pango_font_description_free (fdesc);
+  fdesc = NULL;
+  if (text_map)
+    g_mapped_file_unref (text_map);
+  text_map = NULL;
+}
+
+/* image prepared for printing. it is kept for preview, next copies and next jobs */
+static cairo_surface_t *image_surface = NULL;
+static gchar *image_file = NULL;
+static gint image_width, image_height;
 
-  cairo_move_to (cr, 0, HEADER_HEIGHT + HEADER_GAP);
+/* load image with size of w x h pixels. large images are never decoded in full size */
+static GdkPixbuf *
+load_print_image (gint w, gint h, gint iw, gint ih)
+{
+  GdkPixbuf *pb;
+  gint lw, lh;
+  GError *err = NULL;
 
-  line = page * nlines;
-  for (i = 0; i < nlines; i++)
+  /* in quality mode image is loaded in bigger size for better resampling */
+  if (options.print_data.fast_scale)
     {
-      if (text[line + i] == NULL)
-        break;
-      pango_layout_set_text (layout, text[line + i], -1);
-      pango_cairo_show_layout (cr, layout);
-      cairo_rel_move_to (cr, 0, FONTSIZE);
+      lw = w;
+      lh = h;
+    }
+  else
+    {
+      lw = MIN (iw, 2 * w);
+      lh = MIN (ih, 2 * h);
     }
 
-  g_object_unref (layout);
+  if (lw < iw || lh < ih)
+    pb = gdk_pixbuf_new_from_file_at_size (options.common_data.uri, lw, lh, &err);
+  else
+    pb = gdk_pixbuf_new_from_file (options.common_data.uri, &err);
+  if (!pb)
+    {
+      g_printerr (_("Cannot load image %s: %s\n"), options.common_data.uri, err->message);
+      g_error_free (err);
+      return NULL;
+    }
+
+  if (!options.print_data.fast_scale &&
+      (gdk_pixbuf_get_width (pb) != w || gdk_pixbuf_get_height (pb) != h))
+    {
+      GdkPixbuf *spb = gdk_pixbuf_scale_simple (pb, w, h, GDK_INTERP_HYPER);
+      g_object_unref (pb);
+      pb = spb;
+    }
+
+  return pb;
 }
 
 static void
 draw_page_image (GtkPrintOperation * op, GtkPrintContext * cnt, gint page, gpointer data)
 {
   cairo_t *cr;
-  GdkPixbuf *pb, *spb;
-  guint iw, ih;
-  gdouble pw, ph;
-  gdouble factor;
+  gint iw, ih, w, h;
+  gdouble pw, ph, top = 0;
+  gdouble factor, dpi;
 
   cr = gtk_print_context_get_cairo_context (cnt);
 
   pw = gtk_print_context_get_width (cnt);
   ph = gtk_print_context_get_height (cnt);
   if (options.print_data.headers)
-    ph -= HEADER_HEIGHT + HEADER_GAP;
+    {
+      top = HEADER_HEIGHT + HEADER_GAP;
+      ph -= top;
+    }
 
   /* create header */
   if (options.print_data.headers)
     draw_header (cnt, 1, 1);
 
-  /* scale image to page size */
-  pb = gdk_pixbuf_new_from_file (options.common_data.uri, NULL);
-  iw = gdk_pixbuf_get_width (pb);
-  ih = gdk_pixbuf_get_height (pb);
+  if (!gdk_pixbuf_get_file_info (options.common_data.uri, &iw, &ih) || iw <= 0 || ih <= 0)
+    {
+      g_printerr (_("Unknown image format of %s\n"), options.common_data.uri);
+      return;
+    }
+
+  /* image pixel is a point, large images are scaled down to page size */
+  factor = MIN (1.0, MIN (pw / iw, ph / ih));
+
+  /* image is prepared in printer resolution, but not bigger than original */
+  dpi = MIN (gtk_print_context_get_dpi_x (cnt), gtk_print_context_get_dpi_y (cnt));
+  w = MAX (1, MIN (iw, iw * factor * dpi / 72));
+  h = MAX (1, MIN (ih, ih * factor * dpi / 72));
 
-  if (pw < iw || ph < ih)
+  if (!image_surface || image_width != w || image_height != h || strcmp (image_file, options.common_data.uri) != 0)
     {
-      factor = MIN (pw / iw, ph / ih);
-      factor = (factor > 1.0) ? 1.0 : factor;
-      spb = gdk_pixbuf_scale_simple (pb, iw * factor, ih * factor, GDK_INTERP_HYPER);
+      GdkPixbuf *pb;
+      cairo_t *icr;
+
+      if (image_surface)
+        cairo_surface_destroy (image_surface);
+      image_surface = NULL;
+      g_free (image_file);
+      image_file = g_strdup (options.common_data.uri);
+
+      if ((pb = load_print_image (w, h, iw, ih)) == NULL)
+        return;
+
+      image_width = w;
+      image_height = h;
+      image_surface = cairo_image_surface_create (gdk_pixbuf_get_has_alpha (pb) ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+                                                  gdk_pixbuf_get_width (pb), gdk_pixbuf_get_height (pb));
+      icr = cairo_create (image_surface);
+      gdk_cairo_set_source_pixbuf (icr, pb, 0, 0);
+      cairo_paint (icr);
+      cairo_destroy (icr);
+      g_object_unref (pb);
     }
-  else
-    spb = g_object_ref (pb);
-  g_object_unref (pb);
 
-  /* add image to surface */
-  gdk_cairo_set_source_pixbuf (cr, spb, 0.0, HEADER_HEIGHT + HEADER_GAP);
+  /* add image to surface. cairo scales it to the page size */
+  cairo_save (cr);
+  cairo_translate (cr, 0.0, top);
+  cairo_scale (cr, iw * factor / cairo_image_surface_get_width (image_surface),
+               ih * factor / cairo_image_surface_get_height (image_surface));
+  cairo_set_source_surface (cr, image_surface, 0.0, 0.0);
+  cairo_pattern_set_filter (cairo_get_source (cr),
+                            options.print_data.fast_scale ? CAIRO_FILTER_FAST : CAIRO_FILTER_GOOD);
   cairo_paint (cr);
-  g_object_unref (spb);
+  cairo_restore (cr);
+}
+
+/* connect drawing handlers of source type */
+static void
+setup_operation (GtkPrintOperation * op)
+{
+  switch (options.print_data.type)
+    {
+    case YAD_PRINT_TEXT:
+      g_signal_connect (G_OBJECT (op), "begin-print", G_CALLBACK (begin_print_text), NULL);
+      g_signal_connect (G_OBJECT (op), "paginate", G_CALLBACK (paginate_text), NULL);
+      g_signal_connect (G_OBJECT (op), "draw-page", G_CALLBACK (draw_page_text), NULL);
+      break;
+    case YAD_PRINT_IMAGE:
+      gtk_print_operation_set_n_pages (op, 1);
+      g_signal_connect (G_OBJECT (op), "draw-page", G_CALLBACK (draw_page_image), NULL);
+      break;
+    default:;
+    }
+  g_signal_connect (G_OBJECT (op), "end-print", G_CALLBACK (end_print), NULL);
+}
+
+/* export one file to pdf in export directory */
+static gboolean
+export_file (gchar * fn, GHashTable * names)
+{
+  GtkPrintOperation *op;
+  gchar *bn, *out, *uri;
+  guint n = 1;
+  gboolean ret = TRUE;
+  GError *err = NULL;
+
+  if (!g_file_test (fn, G_FILE_TEST_IS_REGULAR))
+    {
+      g_printerr (_("File %s not found.\n"), fn);
+      return FALSE;
+    }
+
+  /* full name is kept, so files with different extensions don't overwrite each other.
+   * files with the same name from different directories get numbers */
+  bn = g_path_get_basename (fn);
+  out = g_strdup_printf ("%s/%s.pdf", options.print_data.export_dir, bn);
+  while (g_hash_table_contains (names, out))
+    {
+      g_free (out);
+      out = g_strdup_printf ("%s/%s-%u.pdf", options.print_data.export_dir, bn, ++n);
+    }
+  g_hash_table_add (names, g_strdup (out));
+  g_free (bn);
+
+  /* drawing handlers get source file from options */
+  uri = options.common_data.uri;
+  options.common_data.uri = fn;
+
+  op = gtk_print_operation_new ();
+  gtk_print_operation_set_unit (op, GTK_UNIT_POINTS);
+  if (settings.print_settings)
+    gtk_print_operation_set_print_settings (op, settings.print_settings);
+  if (settings.page_setup)
+    gtk_print_operation_set_default_page_setup (op, settings.page_setup);
+  gtk_print_operation_set_export_filename (op, out);
+  setup_operation (op);
+
+  if (gtk_print_operation_run (op, GTK_PRINT_OPERATION_ACTION_EXPORT, NULL, &err) == GTK_PRINT_OPERATION_RESULT_ERROR)
+    {
+      g_printerr (_("Printing failed: %s\n"), err->message);
+      g_error_free (err);
+      ret = FALSE;
+    }
+  else
+    g_print ("%s\n", out);
+
+  g_object_unref (op);
+  g_free (out);
+  options.common_data.uri = uri;
+
+  return ret;
+}
+
+/* export all files from command line or from stdin in one process */
+static gint
+export_files (void)
+{
+  GHashTable *names;
+  gint ret = 0;
+
+  if (options.print_data.type == YAD_PRINT_RAW)
+    {
+      g_printerr (_("Files of RAW type cannot be exported.\n"));
+      return 1;
+    }
+
+  if (g_mkdir_with_parents (options.print_data.export_dir, 0755) == -1)
+    {
+      g_printerr (_("Cannot create directory %s: %s\n"), options.print_data.export_dir, g_strerror (errno));
+      return 1;
+    }
+
+  /* names of created files */
+  names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  if (options.common_data.uri || options.extra_data)
+    {
+      gchar *uri = options.common_data.uri;
+      gint i;
+
+      if (uri && !export_file (uri, names))
+        ret = 1;
+      for (i = 0; options.extra_data && options.extra_data[i]; i++)
+        {
+          if (!export_file (options.extra_data[i], names))
+            ret = 1;
+        }
+    }
+  else
+    {
+      /* read list of files from stdin. each one is exported as soon as it is read */
+      GIOChannel *ch = g_io_channel_unix_new (0);
+      gchar *line;
+
+      while (g_io_channel_read_line (ch, &line, NULL, NULL, NULL) == G_IO_STATUS_NORMAL)
+        {
+          if (line[0] && line[0] != '\n')
+            {
+              strip_new_line (line);
+              if (!export_file (line, names))
+                ret = 1;
+            }
+          g_free (line);
+        }
+      g_io_channel_unref (ch);
+    }
+
+  g_hash_table_destroy (names);
+
+  if (image_surface)
+    cairo_surface_destroy (image_surface);
+  image_surface = NULL;
+
+  return ret;
 }
 
 static void
@@ -219,6 +707,9 @@ yad_print_run (void)
   gint ret = 0;
   GError *err = NULL;
 
+  if (options.print_data.export_dir)
+    return export_files ();
+
   /* check if file is exists */
   if (options.common_data.uri && options.common_data.uri[0])
     {
@@ -347,18 +838,7 @@ yad_print_run (void)
           gtk_print_operation_set_default_page_setup (op, settings.page_setup);
           gtk_print_operation_set_job_name (op, job_name);
 
-          switch (options.print_data.type)
-            {
-            case YAD_PRINT_TEXT:
-              g_signal_connect (G_OBJECT (op), "begin-print", G_CALLBACK (begin_print_text), NULL);
-              g_signal_connect (G_OBJECT (op), "draw-page", G_CALLBACK (draw_page_text), NULL);
-              break;
-            case YAD_PRINT_IMAGE:
-              gtk_print_operation_set_n_pages (op, 1);
-              g_signal_connect (G_OBJECT (op), "draw-page", G_CALLBACK (draw_page_image), NULL);
-              break;
-            default:;
-            }
+          setup_operation (op);
 
           if (gtk_print_operation_run (op, act, NULL, &err) == GTK_PRINT_OPERATION_RESULT_ERROR)
             {
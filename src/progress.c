@@ -37,105 +37,92 @@ pulsate_progress_bar (gpointer user_data)
   return TRUE;
 }
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+/* only the last percentage and the last comment are shown. comments written to log are all kept */
+static gchar *
+record_key (gchar * line)
+{
+  if (line[0] == '#')
+    return options.progress_data.log ? NULL : g_strdup ("#");
+  if (g_ascii_isdigit (line[0]))
+    return g_strdup ("%");
+  return NULL;
+}
+
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
 {
   static guint pulsate_timeout = 0;
   float percentage = 0.0;
+  guint i;
 
-  if ((condition == G_IO_IN) || (condition == G_IO_IN + G_IO_HUP))
+  if (options.progress_data.pulsate)
     {
-      GString *string;
-      GError *err = NULL;
-
-      string = g_string_new (NULL);
-
-      if (options.progress_data.pulsate)
-        {
-          if (pulsate_timeout == 0)
-            pulsate_timeout = g_timeout_add (100, pulsate_progress_bar, NULL);
-        }
+      if (pulsate_timeout == 0 && !eof)
+        pulsate_timeout = g_timeout_add (100, pulsate_progress_bar, NULL);
+    }
 
-      while (channel->is_readable != TRUE);
+  for (i = 0; i < n_lines; i++)
+    {
+      gchar *line = lines[i];
 
-      do
+      if (line[0] == '#')
         {
-          gint status;
-
-          do
-            {
-              status = g_io_channel_read_line_string (channel, string, NULL, &err);
-              while (gtk_events_pending ())
-                gtk_main_iteration ();
-            }
-          while (status == G_IO_STATUS_AGAIN);
-
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (err)
-                {
-                  g_printerr ("yad_progress_handle_stdin(): %s\n", err->message);
-                  g_error_free (err);
-                  err = NULL;
-                }
-              /* stop handling */
-              g_io_channel_shutdown (channel, TRUE, NULL);
-              return FALSE;
-            }
+          gchar *match;
 
-          if (string->str[0] == '#')
+          /* We have a comment, so let's try to change the label or write it to the log */
+          match = g_strcompress (g_strstrip (line + 1));
+          if (options.progress_data.log)
             {
-              gchar *match;
+              gchar *logline;
+              GtkTextIter end;
 
-              /* We have a comment, so let's try to change the label or write it to the log */
-              match = g_strcompress (g_strstrip (string->str + 1));
-              if (options.progress_data.log)
-                {
-                  gchar *logline;
-                  GtkTextIter end;
-
-                  logline = g_strdup_printf ("%s\n", match);    /* add new line */
-                  gtk_text_buffer_get_end_iter (log_buffer, &end);
-                  gtk_text_buffer_insert (log_buffer, &end, logline, -1);
-                  g_free (logline);
-
-                  /* scroll to end */
-                  while (gtk_events_pending ())
-                    gtk_main_iteration ();
-                  gtk_text_buffer_get_end_iter (log_buffer, &end);
-                  gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (progress_log), &end, 0, FALSE, 0, 0);
-                }
-              else
-                gtk_progress_bar_set_text (GTK_PROGRESS_BAR (progress_bar), match);
-              g_free (match);
+              logline = g_strdup_printf ("%s\n", match);    /* add new line */
+              gtk_text_buffer_get_end_iter (log_buffer, &end);
+              gtk_text_buffer_insert (log_buffer, &end, logline, -1);
+              g_free (logline);
             }
           else
+            gtk_progress_bar_set_text (GTK_PROGRESS_BAR (progress_bar), match);
+          g_free (match);
+        }
+      else
+        {
+          if (g_ascii_isdigit (*line))
             {
-              if (g_ascii_isdigit (*(string->str)))
+              /* Now try to convert the thing to a number */
+              percentage = atoi (line);
+              if (percentage >= 100)
                 {
-                  /* Now try to convert the thing to a number */
-                  percentage = atoi (string->str);
-                  if (percentage >= 100)
-                    {
-                      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress_bar), 1.0);
-                      if (options.progress_data.autoclose && options.plug == -1)
-                        gtk_dialog_response (GTK_DIALOG (data), YAD_RESPONSE_OK);
-                    }
-                  else
-                    gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress_bar), percentage / 100.0);
+                  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress_bar), 1.0);
+                  if (options.progress_data.autoclose && options.plug == -1)
+                    gtk_dialog_response (GTK_DIALOG (data), YAD_RESPONSE_OK);
                 }
+              else
+                gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress_bar), percentage / 100.0);
             }
-
         }
-      while (g_io_channel_get_buffer_condition (channel) == G_IO_IN);
-      g_string_free (string, TRUE);
     }
 
-  if ((condition != G_IO_IN) && (condition != G_IO_IN + G_IO_HUP))
+  /* scroll log to end */
+  if (options.progress_data.log && n_lines > 0)
+    {
+      GtkTextIter end;
+      GtkTextMark *mark;
+
+      gtk_text_buffer_get_end_iter (log_buffer, &end);
+      mark = gtk_text_buffer_get_mark (log_buffer, "yad-tail");
+      if (mark)
+        gtk_text_buffer_move_mark (log_buffer, mark, &end);
+      else
+        mark = gtk_text_buffer_create_mark (log_buffer, "yad-tail", &end, FALSE);
+      gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (progress_log), mark, 0, FALSE, 0, 0);
+    }
+
+  if (eof)
     {
       gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress_bar), 1.0);
 
-      if (options.progress_data.pulsate)
+      if (pulsate_timeout)
         {
           g_source_remove (pulsate_timeout);
           pulsate_timeout = 0;
@@ -143,18 +130,13 @@ handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
 
       if (options.progress_data.autoclose && options.plug == -1)
         gtk_dialog_response (GTK_DIALOG (data), YAD_RESPONSE_OK);
-
-      g_io_channel_shutdown (channel, TRUE, NULL);
-      return FALSE;
     }
-  return TRUE;
 }
 
 GtkWidget *
 progress_create_widget (GtkWidget * dlg)
 {
   GtkWidget *w;
-  GIOChannel *channel;
 
   // fix it when vertical specified
 #if GTK_CHECK_VERSION(3,0,0)
@@ -213,10 +195,7 @@ progress_create_widget (GtkWidget * dlg)
     gtk_progress_bar_set_show_text (GTK_PROGRESS_BAR (progress_bar), TRUE);
 #endif
 
-  channel = g_io_channel_unix_new (0);
-  g_io_channel_set_encoding (channel, NULL, NULL);
-  g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-  g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, dlg);
+  read_input (1, record_key, handle_stdin, dlg);
 
   return w;
 }
@@ -27,6 +27,14 @@ value_changed_cb (GtkWidget * w, gpointer data)
   g_print ("%.0f\n", gtk_range_get_value (GTK_RANGE (w)));
 }
 
+static void
+print_changes_cb (GtkWidget * w, gpointer data)
+{
+  gchar *val = g_strdup_printf ("%.0f", gtk_range_get_value (GTK_RANGE (w)));
+  print_change (0, val);
+  g_free (val);
+}
+
 GtkWidget *
 scale_create_widget (GtkWidget * dlg)
 {
@@ -87,6 +95,8 @@ scale_create_widget (GtkWidget * dlg)
 
   if (options.scale_data.print_partial)
     g_signal_connect (G_OBJECT (w), "value-changed", G_CALLBACK (value_changed_cb), NULL);
+  if (options.common_data.print_changes)
+    g_signal_connect (G_OBJECT (w), "value-changed", G_CALLBACK (print_changes_cb), NULL);
 
   if (options.scale_data.hide_value)
     gtk_scale_set_draw_value (GTK_SCALE (w), FALSE);
@@ -298,77 +298,79 @@ linkify_cb (GtkTextBuffer * buf, GRegex * regex)
   g_free (text);
 }
 
-static gboolean
-handle_stdin (GIOChannel * channel, GIOCondition condition, gpointer data)
+static void
+insert_text (GString * string)
 {
-  if ((condition & G_IO_IN) || (condition & (G_IO_IN | G_IO_HUP)))
+  GtkTextIter end;
+
+  if (string->len == 0)
+    return;
+
+  gtk_text_buffer_get_end_iter (text_buffer, &end);
+
+  if (!g_utf8_validate (string->str, string->len, NULL))
     {
-      GString *string;
-      GError *err = NULL;
-      gint status;
+      gchar *utftext =
+        g_convert_with_fallback (string->str, string->len, "UTF-8", "ISO-8859-1", NULL, NULL, NULL, NULL);
+      gtk_text_buffer_insert (text_buffer, &end, utftext, -1);
+      g_free (utftext);
+    }
+  else
+    gtk_text_buffer_insert (text_buffer, &end, string->str, string->len);
 
-      string = g_string_new (NULL);
-      while (channel->is_readable != TRUE);
+  g_string_truncate (string, 0);
+}
 
-      do
-        {
-          status = g_io_channel_read_line_string (channel, string, NULL, &err);
-          while (gtk_events_pending ())
-            gtk_main_iteration ();
-        }
-      while (status == G_IO_STATUS_AGAIN);
+static void
+handle_stdin (gchar ** lines, guint n_lines, gboolean eof, gpointer data)
+{
+  GString *string;
+  guint i;
 
-      if (status != G_IO_STATUS_NORMAL)
-        {
-          if (err)
-            {
-              g_printerr ("yad_text_handle_stdin(): %s\n", err->message);
-              g_error_free (err);
-              err = NULL;
-            }
-          /* stop handling */
-          g_io_channel_shutdown (channel, TRUE, NULL);
-          return FALSE;
-        }
+  string = g_string_sized_new (4096);
 
-      if (string->str[0] == '\014')
+  /* collect lines and insert them at once */
+  for (i = 0; i < n_lines; i++)
+    {
+      if (lines[i][0] == '\014')
         {
           GtkTextIter start, end;
 
           /* clear text if ^L received */
+          g_string_truncate (string, 0);
           gtk_text_buffer_get_start_iter (text_buffer, &start);
           gtk_text_buffer_get_end_iter (text_buffer, &end);
           gtk_text_buffer_delete (text_buffer, &start, &end);
+          continue;
         }
-      else if (string->len > 0)
+
+      g_string_append (string, lines[i]);
+      /* the rest of data at the end of input is unterminated */
+      if (!eof)
+        g_string_append_c (string, '\n');
+    }
+
+  if (string->len > 0)
+    {
+      insert_text (string);
+
+      if (options.text_data.tail)
         {
           GtkTextIter end;
+          GtkTextMark *mark;
 
+          /* scrolling to mark is done after buffer validation */
           gtk_text_buffer_get_end_iter (text_buffer, &end);
-
-          if (!g_utf8_validate (string->str, string->len, NULL))
-            {
-              gchar *utftext =
-                g_convert_with_fallback (string->str, string->len, "UTF-8", "ISO-8859-1", NULL, NULL, NULL, NULL);
-              gtk_text_buffer_insert (text_buffer, &end, utftext, -1);
-              g_free (utftext);
-            }
+          mark = gtk_text_buffer_get_mark (text_buffer, "yad-tail");
+          if (mark)
+            gtk_text_buffer_move_mark (text_buffer, mark, &end);
           else
-            gtk_text_buffer_insert (text_buffer, &end, string->str, string->len);
-
-          if (options.text_data.tail)
-            {
-              while (gtk_events_pending ())
-                gtk_main_iteration ();
-              gtk_text_buffer_get_end_iter (text_buffer, &end);
-              gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (text_view), &end, 0, FALSE, 0, 0);
-            }
+            mark = gtk_text_buffer_create_mark (text_buffer, "yad-tail", &end, FALSE);
+          gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (text_view), mark, 0, FALSE, 0, 0);
         }
-
-      g_string_free (string, TRUE);
     }
 
-  return TRUE;
+  g_string_free (string, TRUE);
 }
 
 static void
@@ -439,12 +441,7 @@ fill_buffer_from_file ()
 static void
 fill_buffer_from_stdin ()
 {
-  GIOChannel *channel;
-
-  channel = g_io_channel_unix_new (0);
-  g_io_channel_set_encoding (channel, NULL, NULL);
-  g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
-  g_io_add_watch (channel, G_IO_IN | G_IO_HUP, handle_stdin, NULL);
+  read_input (1, NULL, handle_stdin, NULL);
 }
 
 GtkWidget *
@@ -539,7 +536,7 @@ text_create_widget (GtkWidget * dlg)
   if (options.common_data.uri)
     fill_buffer_from_file ();
 
-  if (options.common_data.listen || options.common_data.uri == NULL)
+  if (options.common_data.listen || options.common_data.listen_socket || options.common_data.uri == NULL)
     fill_buffer_from_stdin ();
 
   return w;
@@ -20,9 +20,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <poll.h>
 
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
 
 #include "yad.h"
 
@@ -426,3 +432,757 @@ escape_str (gchar *str)
 
   return res;
 }
+
+/* line reader for streaming dialogs */
+#define YAD_READ_BLOCK 65536
+#define YAD_QUEUE_SIZE 256
+#define YAD_FRAME_TIME 16
+#define YAD_HIGH_WATER 1000
+
+typedef struct {
+  gchar *buf;
+  gchar **lines;
+  guint n_lines;
+  gboolean eof;
+} YadLineBatch;
+
+typedef struct {
+  gint fd;
+  /* socket client. delivers only whole records and never reports eof */
+  gboolean client;
+  guint rec_size;
+  YadBackpressure policy;
+  guint limit;
+  YadRecordKeyFunc key_func;
+  YadLinesFunc func;
+  gpointer data;
+  gint ref;
+  /* single producer/single consumer ring. head is owned by main thread, tail by reader thread */
+  YadLineBatch *ring[YAD_QUEUE_SIZE];
+  gint head;
+  gint tail;
+  gint scheduled;
+  /* number of lines in the ring */
+  gint queued;
+  /* incomplete record of socket client, waiting for the rest of lines */
+  GPtrArray *pending;
+  /* record collected by reader thread, when input may be dropped or coalesced */
+  GPtrArray *record;
+  /* queued complete records and number of them without clear records */
+  GQueue *records;
+  guint n_records;
+  /* links of queued records by their keys, for coalescing */
+  GHashTable *keys;
+  /* protects records, also used for waiting on full ring */
+  GMutex lock;
+  GCond cond;
+} YadLineReader;
+
+static gint dropped_records = 0;
+static gint coalesced_records = 0;
+
+static void
+print_input_stats (void)
+{
+  if (dropped_records)
+    g_printerr ("yad: %d input records dropped\n", dropped_records);
+  if (coalesced_records)
+    g_printerr ("yad: %d input records coalesced\n", coalesced_records);
+}
+
+static void
+line_reader_unref (YadLineReader * r)
+{
+  if (g_atomic_int_dec_and_test (&r->ref))
+    {
+      g_mutex_clear (&r->lock);
+      g_cond_clear (&r->cond);
+      if (r->pending)
+        g_ptr_array_free (r->pending, TRUE);
+      if (r->record)
+        g_ptr_array_free (r->record, TRUE);
+      if (r->records)
+        g_queue_free_full (r->records, (GDestroyNotify) g_strfreev);
+      if (r->keys)
+        g_hash_table_destroy (r->keys);
+      g_free (r);
+    }
+}
+
+static inline gboolean
+queue_full (YadLineReader * r)
+{
+  if ((g_atomic_int_get (&r->tail) + 1) % YAD_QUEUE_SIZE == g_atomic_int_get (&r->head))
+    return TRUE;
+  if (r->limit && g_atomic_int_get (&r->queued) >= r->limit * r->rec_size)
+    return TRUE;
+  return FALSE;
+}
+
+/* records are compared by the key from dialog. record without key is never coalesced */
+static gchar *
+record_key (YadLineReader * r, gchar ** rec)
+{
+  return r->key_func ? r->key_func (rec[0]) : NULL;
+}
+
+/* ^L line is a record itself, which is never dropped */
+static inline gboolean
+is_clear_record (gchar ** rec)
+{
+  return rec[0][0] == '\014';
+}
+
+static void
+unlink_record (YadLineReader * r, GList * l)
+{
+  gchar **rec = (gchar **) l->data;
+
+  if (r->keys)
+    {
+      gchar *key = record_key (r, rec);
+
+      /* the key may already belong to record after clear */
+      if (key && g_hash_table_lookup (r->keys, key) == l)
+        g_hash_table_remove (r->keys, key);
+      g_free (key);
+    }
+
+  g_strfreev (rec);
+  g_queue_delete_link (r->records, l);
+  r->n_records--;
+}
+
+static void
+drop_oldest_record (YadLineReader * r)
+{
+  GList *l;
+
+  for (l = r->records->head; l; l = l->next)
+    {
+      if (!is_clear_record ((gchar **) l->data))
+        {
+          unlink_record (r, l);
+          g_atomic_int_inc (&dropped_records);
+          return;
+        }
+    }
+}
+
+/* add complete record to the queue according to backpressure policy. must be called with lock held */
+static void
+queue_record (YadLineReader * r, gchar ** rec)
+{
+  gchar *key;
+  GList *l;
+
+  if (is_clear_record (rec))
+    {
+      /* successive clears are the same as one */
+      if (r->records->tail && is_clear_record ((gchar **) r->records->tail->data))
+        g_strfreev (rec);
+      else
+        g_queue_push_tail (r->records, rec);
+      /* records before and after clear must not be coalesced */
+      if (r->keys)
+        g_hash_table_remove_all (r->keys);
+      return;
+    }
+
+  if (r->policy == YAD_BACKPRESSURE_DROP_NEWEST)
+    {
+      if (r->n_records >= r->limit)
+        {
+          g_strfreev (rec);
+          g_atomic_int_inc (&dropped_records);
+          return;
+        }
+    }
+  else if (r->policy == YAD_BACKPRESSURE_COALESCE && (key = record_key (r, rec)) != NULL)
+    {
+      /* keep only the newest record for each key */
+      l = (GList *) g_hash_table_lookup (r->keys, key);
+      if (l)
+        {
+          unlink_record (r, l);
+          g_atomic_int_inc (&coalesced_records);
+        }
+      else if (r->n_records >= r->limit)
+        drop_oldest_record (r);
+
+      g_queue_push_tail (r->records, rec);
+      g_hash_table_insert (r->keys, key, r->records->tail);
+      r->n_records++;
+      return;
+    }
+  else if (r->n_records >= r->limit)
+    drop_oldest_record (r);
+
+  g_queue_push_tail (r->records, rec);
+  r->n_records++;
+}
+
+static void
+complete_record (YadLineReader * r, gboolean queue)
+{
+  g_ptr_array_add (r->record, NULL);
+  /* incomplete rest of stdin is passed as is */
+  if (queue)
+    queue_record (r, (gchar **) g_ptr_array_free (r->record, FALSE));
+  else
+    g_queue_push_tail (r->records, g_ptr_array_free (r->record, FALSE));
+  r->record = g_ptr_array_new_with_free_func (g_free);
+}
+
+/* split batch into records and queue them. reader never waits here, so lines are copied */
+static void
+push_records (YadLineReader * r, YadLineBatch * b)
+{
+  guint i, n;
+
+  /* unterminated rest of stdin is not a record */
+  n = (b->eof && !r->client) ? 0 : b->n_lines;
+
+  g_mutex_lock (&r->lock);
+  for (i = 0; i < n; i++)
+    {
+      gchar *line = b->lines[i];
+
+      if (line[0] == '\014')
+        g_ptr_array_set_size (r->record, 0);
+      g_ptr_array_add (r->record, g_strdup (line));
+      if (line[0] == '\014' || r->record->len == r->rec_size)
+        complete_record (r, TRUE);
+    }
+
+  if (b->eof)
+    {
+      if (r->client)
+        {
+          /* incomplete record of disconnected client is useless */
+          g_ptr_array_set_size (r->record, 0);
+          b->n_lines = 0;
+          b->lines[0] = NULL;
+        }
+      else if (r->record->len > 0)
+        complete_record (r, FALSE);
+    }
+  g_mutex_unlock (&r->lock);
+}
+
+/* move incomplete record from the end of lines to the pending list of socket client */
+static void
+hold_tail (YadLineReader * r, GPtrArray * lines)
+{
+  guint i, pos = 0, tail;
+
+  for (i = 0; i < lines->len; i++)
+    {
+      gchar *line = (gchar *) g_ptr_array_index (lines, i);
+
+      if (line[0] == '\014')
+        pos = 0;
+      else
+        pos = (pos + 1) % r->rec_size;
+    }
+
+  tail = lines->len - pos;
+  for (i = tail; i < lines->len; i++)
+    g_ptr_array_add (r->pending, g_strdup ((gchar *) g_ptr_array_index (lines, i)));
+  g_ptr_array_set_size (lines, tail);
+}
+
+static void
+free_batch (YadLineBatch * b)
+{
+  g_free (b->lines);
+  g_free (b->buf);
+  g_free (b);
+}
+
+static gboolean
+drain_queue_cb (gpointer data)
+{
+  YadLineReader *r = (YadLineReader *) data;
+  GPtrArray *batches, *lines, *held = NULL;
+  GQueue *records = NULL;
+  YadLineBatch *eb = NULL;
+  GList *l;
+  guint i, n = 0;
+  gint h;
+
+  /* must be reset before reading the queue, so new data always schedules a new call */
+  g_atomic_int_set (&r->scheduled, 0);
+
+  batches = g_ptr_array_new_with_free_func ((GDestroyNotify) free_batch);
+  lines = g_ptr_array_new ();
+
+  if (r->client)
+    {
+      /* incomplete record from the previous call goes first */
+      held = r->pending;
+      r->pending = g_ptr_array_new_with_free_func (g_free);
+      for (i = 0; i < held->len; i++)
+        g_ptr_array_add (lines, g_ptr_array_index (held, i));
+    }
+
+  if (r->records)
+    {
+      g_mutex_lock (&r->lock);
+      records = r->records;
+      r->records = g_queue_new ();
+      r->n_records = 0;
+      if (r->keys)
+        g_hash_table_remove_all (r->keys);
+      g_mutex_unlock (&r->lock);
+
+      for (l = records->head; l; l = l->next)
+        {
+          gchar **rec = (gchar **) l->data;
+
+          for (i = 0; rec[i]; i++)
+            g_ptr_array_add (lines, rec[i]);
+        }
+    }
+
+  h = g_atomic_int_get (&r->head);
+  while (h != g_atomic_int_get (&r->tail))
+    {
+      YadLineBatch *b = r->ring[h];
+
+      h = (h + 1) % YAD_QUEUE_SIZE;
+      g_atomic_int_set (&r->head, h);
+
+      g_ptr_array_add (batches, b);
+      n += b->n_lines;
+      if (b->eof)
+        eb = b;
+      /* unterminated rest of client data is a regular line */
+      if (!b->eof || r->client)
+        {
+          for (i = 0; i < b->n_lines; i++)
+            g_ptr_array_add (lines, b->lines[i]);
+        }
+    }
+  g_atomic_int_add (&r->queued, -n);
+
+  /* wake up the reader if it waits for free space */
+  g_mutex_lock (&r->lock);
+  g_cond_signal (&r->cond);
+  g_mutex_unlock (&r->lock);
+
+  if (r->client)
+    {
+      hold_tail (r, lines);
+      /* incomplete record of disconnected client is useless */
+      if (eb)
+        {
+          g_ptr_array_set_size (r->pending, 0);
+          eb = NULL;
+        }
+    }
+
+  if (lines->len > 0)
+    r->func ((gchar **) lines->pdata, lines->len, FALSE, r->data);
+  if (eb)
+    r->func (eb->lines, eb->n_lines, TRUE, r->data);
+
+  g_ptr_array_free (batches, TRUE);
+  g_ptr_array_free (lines, TRUE);
+  if (held)
+    g_ptr_array_free (held, TRUE);
+  if (records)
+    g_queue_free_full (records, (GDestroyNotify) g_strfreev);
+
+  line_reader_unref (r);
+
+  return FALSE;
+}
+
+/* main thread handles the queue once per frame */
+static void
+schedule_drain (YadLineReader * r)
+{
+  if (g_atomic_int_compare_and_exchange (&r->scheduled, 0, 1))
+    {
+      g_atomic_int_inc (&r->ref);
+      g_timeout_add (YAD_FRAME_TIME, drain_queue_cb, r);
+    }
+}
+
+static void
+push_batch (YadLineReader * r, YadLineBatch * b)
+{
+  gint t;
+
+  if (r->records)
+    {
+      /* records are dropped or coalesced instead of waiting, only the last batch goes to the ring */
+      push_records (r, b);
+      if (!b->eof)
+        {
+          free_batch (b);
+          schedule_drain (r);
+          return;
+        }
+    }
+  else
+    {
+      g_mutex_lock (&r->lock);
+      while (queue_full (r))
+        g_cond_wait (&r->cond, &r->lock);
+      g_mutex_unlock (&r->lock);
+    }
+
+  g_atomic_int_add (&r->queued, b->n_lines);
+
+  t = g_atomic_int_get (&r->tail);
+  r->ring[t] = b;
+  g_atomic_int_set (&r->tail, (t + 1) % YAD_QUEUE_SIZE);
+
+  schedule_drain (r);
+}
+
+static YadLineBatch *
+split_lines (gchar * buf, gsize len, gsize * rest)
+{
+  YadLineBatch *b;
+  GPtrArray *lines;
+  gchar *p, *end, *nl;
+
+  lines = g_ptr_array_new ();
+
+  p = buf;
+  end = buf + len;
+  while ((nl = memchr (p, '\n', end - p)) != NULL)
+    {
+      *nl = '\0';
+      g_ptr_array_add (lines, p);
+      p = nl + 1;
+    }
+  *rest = end - p;
+
+  b = g_new0 (YadLineBatch, 1);
+  b->buf = buf;
+  b->n_lines = lines->len;
+  g_ptr_array_add (lines, NULL);
+  b->lines = (gchar **) g_ptr_array_free (lines, FALSE);
+
+  return b;
+}
+
+static gpointer
+line_reader_thread (gpointer data)
+{
+  YadLineReader *r = (YadLineReader *) data;
+  YadLineBatch *b;
+  gchar *buf;
+  gsize size, len = 0;
+  gboolean eof = FALSE;
+
+  size = 4 * YAD_READ_BLOCK;
+  buf = g_malloc (size);
+
+  while (!eof)
+    {
+      gssize n;
+      gsize rest;
+
+      if (size - len <= YAD_READ_BLOCK)
+        {
+          size = MAX (size * 2, len + YAD_READ_BLOCK + 1);
+          buf = g_realloc (buf, size);
+        }
+
+      /* reserve one byte for terminating the last line */
+      n = read (r->fd, buf + len, size - len - 1);
+      if (n > 0)
+        len += n;
+      else if (n == 0)
+        eof = TRUE;
+      else if (errno == EINTR)
+        continue;
+      else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          struct pollfd pfd = { r->fd, POLLIN, 0 };
+          poll (&pfd, 1, -1);
+          continue;
+        }
+      else
+        {
+          g_printerr ("yad: cannot read data: %s\n", g_strerror (errno));
+          eof = TRUE;
+        }
+
+      if (!eof && !memchr (buf + len - n, '\n', n))
+        continue;
+
+      /* batch takes the buffer, incomplete line goes to the new one */
+      b = split_lines (buf, len, &rest);
+      size = rest + 2 * YAD_READ_BLOCK;
+      buf = g_malloc (size);
+      memcpy (buf, b->buf + len - rest, rest);
+      len = rest;
+
+      if (b->n_lines > 0)
+        push_batch (r, b);
+      else
+        free_batch (b);
+    }
+
+  /* the last batch contains only unterminated rest of data */
+  buf[len] = '\0';
+  b = g_new0 (YadLineBatch, 1);
+  b->buf = buf;
+  b->lines = g_new0 (gchar *, 2);
+  if (len > 0)
+    {
+      b->lines[0] = buf;
+      b->n_lines = 1;
+    }
+  b->eof = TRUE;
+  push_batch (r, b);
+
+  close (r->fd);
+  line_reader_unref (r);
+
+  return NULL;
+}
+
+static void
+start_reader (gint fd, gboolean client, guint rec_size, YadRecordKeyFunc key_func, YadLinesFunc func, gpointer data)
+{
+  static gboolean stats_init = FALSE;
+  YadLineReader *r;
+
+  if (!stats_init)
+    {
+      atexit (print_input_stats);
+      stats_init = TRUE;
+    }
+
+  r = g_new0 (YadLineReader, 1);
+  r->fd = fd;
+  r->client = client;
+  if (client)
+    r->pending = g_ptr_array_new_with_free_func (g_free);
+  r->rec_size = MAX (rec_size, 1);
+  r->policy = options.common_data.backpressure;
+  /* only dialogs which know commands of their input can coalesce it */
+  if (r->policy == YAD_BACKPRESSURE_COALESCE && !key_func)
+    r->policy = YAD_BACKPRESSURE_DROP_OLDEST;
+  r->key_func = key_func;
+  r->limit = options.common_data.high_water;
+  if (r->policy != YAD_BACKPRESSURE_BLOCK)
+    {
+      if (!r->limit)
+        r->limit = YAD_HIGH_WATER;
+      r->record = g_ptr_array_new_with_free_func (g_free);
+      r->records = g_queue_new ();
+      if (r->policy == YAD_BACKPRESSURE_COALESCE)
+        r->keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    }
+  r->func = func;
+  r->data = data;
+  /* reader thread holds one reference, every scheduled drain holds another */
+  r->ref = 1;
+  g_mutex_init (&r->lock);
+  g_cond_init (&r->cond);
+
+  /* regular file is read ahead by kernel */
+  if (!client)
+    posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  g_thread_unref (g_thread_new ("yad-reader", line_reader_thread, r));
+}
+
+typedef struct {
+  guint rec_size;
+  YadRecordKeyFunc key_func;
+  YadLinesFunc func;
+  gpointer data;
+} YadSocketData;
+
+static gchar *socket_path = NULL;
+
+static void
+remove_socket (void)
+{
+  unlink (socket_path);
+}
+
+static gboolean
+accept_client_cb (GIOChannel * ch, GIOCondition cond, gpointer data)
+{
+  YadSocketData *sd = (YadSocketData *) data;
+  gint fd;
+
+  fd = accept (g_io_channel_unix_get_fd (ch), NULL, NULL);
+  if (fd == -1)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        g_printerr ("yad: cannot accept connection: %s\n", g_strerror (errno));
+      return TRUE;
+    }
+
+  /* each client gets its own reader, so records of different clients never mix */
+  start_reader (fd, TRUE, sd->rec_size, sd->key_func, sd->func, sd->data);
+
+  return TRUE;
+}
+
+static gboolean
+listen_socket (const gchar * path, guint rec_size, YadRecordKeyFunc key_func, YadLinesFunc func, gpointer data)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+  YadSocketData *sd;
+  GIOChannel *ch;
+  gint fd;
+
+  if (strlen (path) >= sizeof (addr.sun_path))
+    {
+      g_printerr ("yad: socket path is too long: %s\n", path);
+      return FALSE;
+    }
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1)
+    {
+      g_printerr ("yad: cannot create socket: %s\n", g_strerror (errno));
+      return FALSE;
+    }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  /* remove stale socket, but never other files or socket of running instance */
+  if (lstat (path, &st) == 0 && S_ISSOCK (st.st_mode))
+    {
+      gint cfd = socket (AF_UNIX, SOCK_STREAM, 0);
+      gint res = -1;
+
+      if (cfd != -1)
+        res = connect (cfd, (struct sockaddr *) &addr, sizeof (addr));
+      if (res == -1 && errno == ECONNREFUSED)
+        unlink (path);
+      else
+        {
+          if (res == 0)
+            g_printerr ("yad: socket %s is used by another process\n", path);
+          else
+            g_printerr ("yad: cannot listen on %s: %s\n", path, g_strerror (errno));
+          close (fd);
+          if (cfd != -1)
+            close (cfd);
+          return FALSE;
+        }
+      close (cfd);
+    }
+
+  if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1 || listen (fd, SOMAXCONN) == -1)
+    {
+      g_printerr ("yad: cannot listen on %s: %s\n", path, g_strerror (errno));
+      close (fd);
+      return FALSE;
+    }
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+  socket_path = g_strdup (path);
+  atexit (remove_socket);
+
+  sd = g_new0 (YadSocketData, 1);
+  sd->rec_size = rec_size;
+  sd->key_func = key_func;
+  sd->func = func;
+  sd->data = data;
+
+  ch = g_io_channel_unix_new (fd);
+  g_io_add_watch (ch, G_IO_IN, accept_client_cb, sd);
+  g_io_channel_unref (ch);
+
+  return TRUE;
+}
+
+void
+read_input (guint rec_size, YadRecordKeyFunc key_func, YadLinesFunc func, gpointer data)
+{
+  if (options.common_data.listen_socket)
+    {
+      if (listen_socket (options.common_data.listen_socket, rec_size, key_func, func, data))
+        return;
+      g_printerr ("yad: reading data from stdin\n");
+    }
+
+  start_reader (0, FALSE, rec_size, key_func, func, data);
+}
+
+/* pending changes by value number. printed in order of numbers */
+static GTree *changes = NULL;
+static guint changes_timeout = 0;
+
+static gint
+num_cmp (gconstpointer a, gconstpointer b, gpointer data)
+{
+  return GPOINTER_TO_INT (a) - GPOINTER_TO_INT (b);
+}
+
+static gboolean
+print_change_node (gpointer key, gpointer value, gpointer data)
+{
+  /* value is already formatted by dialog. number is given only by dialogs with several values */
+  if (GPOINTER_TO_INT (key))
+    g_print ("%d%s%s\n", GPOINTER_TO_INT (key), options.common_data.separator, (gchar *) value);
+  else
+    g_print ("%s\n", (gchar *) value);
+  return FALSE;
+}
+
+void
+flush_changes (void)
+{
+  if (!changes || g_tree_nnodes (changes) == 0)
+    return;
+
+  g_tree_foreach (changes, print_change_node, NULL);
+  fflush (stdout);
+
+  g_tree_destroy (changes);
+  changes = g_tree_new_full (num_cmp, NULL, NULL, g_free);
+}
+
+static gboolean
+changes_timeout_cb (gpointer data)
+{
+  /* nothing was changed during the interval, so the next change may be printed at once */
+  if (g_tree_nnodes (changes) == 0)
+    {
+      changes_timeout = 0;
+      return FALSE;
+    }
+
+  flush_changes ();
+  return TRUE;
+}
+
+void
+print_change (guint num, const gchar * value)
+{
+  if (!changes)
+    {
+      changes = g_tree_new_full (num_cmp, NULL, NULL, g_free);
+      /* the last change is printed even if dialog was cancelled */
+      atexit (flush_changes);
+    }
+
+  /* only the last value of each number is printed */
+  g_tree_replace (changes, GINT_TO_POINTER (num), g_strdup (value));
+
+  if (!changes_timeout)
+    {
+      flush_changes ();
+      if (options.common_data.changes_interval)
+        changes_timeout = g_timeout_add (options.common_data.changes_interval, changes_timeout_cb, NULL);
+    }
+}
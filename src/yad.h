@@ -126,6 +126,13 @@ typedef enum {
   YAD_PROGRESS_PULSE
 } YadProgressType;
 
+typedef enum {
+  YAD_BACKPRESSURE_BLOCK = 0,
+  YAD_BACKPRESSURE_DROP_OLDEST,
+  YAD_BACKPRESSURE_DROP_NEWEST,
+  YAD_BACKPRESSURE_COALESCE
+} YadBackpressure;
+
 typedef enum {
   YAD_BIG_ICON = 0,
   YAD_SMALL_ICON
@@ -139,6 +146,7 @@ typedef struct {
 
 typedef struct {
   gchar *name;
+  gchar *id;
   YadFieldType type;
 } YadField;
 
@@ -196,6 +204,7 @@ typedef struct {
   gint month;
   gint year;
   gchar *details;
+  gchar *details_cmd;
 } YadCalendarData;
 
 typedef struct {
@@ -218,11 +227,14 @@ typedef struct {
   gchar *entry_label;
   gboolean hide_text;
   gboolean completion;
+  gchar *completion_cmd;
+  gboolean fuzzy;
   gboolean numeric;
   gchar *licon;
   gchar *licon_action;
   gchar *ricon;
   gchar *ricon_action;
+  gint icon_timeout;
 } YadEntryData;
 
 typedef struct {
@@ -244,6 +256,7 @@ typedef struct {
   guint columns;
   gboolean scroll;
   gboolean output_by_row;
+  gboolean large_lists;
 } YadFormData;
 
 #ifdef HAVE_HTML
@@ -312,6 +325,8 @@ typedef struct {
 typedef struct {
   YadPrintType type;
   gboolean headers;
+  gboolean fast_scale;
+  gchar *export_dir;
 } YadPrintData;
 
 typedef struct {
@@ -365,6 +380,11 @@ typedef struct {
   gchar *date_format;
   gdouble align;
   gboolean listen;
+  gchar *listen_socket;
+  gboolean print_changes;
+  guint changes_interval;
+  YadBackpressure backpressure;
+  gint high_water;
   gboolean preview;
   gboolean quoted_output;
   GList *filters;
@@ -512,6 +532,27 @@ GtkWidget *get_label (gchar * str, guint border);
 
 gchar *escape_str (gchar *str);
 
+/* callback for streaming input. called from main loop with a batch of complete lines without newlines.
+ * eof is TRUE on the last call, when lines contain only the unterminated rest of data (if any) */
+typedef void (*YadLinesFunc) (gchar ** lines, guint n_lines, gboolean eof, gpointer data);
+
+/* key of input record for --backpressure=coalesce. returns newly allocated string
+ * or NULL if the record must not be replaced by newer one */
+typedef gchar *(*YadRecordKeyFunc) (gchar * line);
+
+/* read records of rec_size lines from stdin or from clients of --listen-socket.
+ * without key_func, coalesce policy works as drop-oldest */
+void read_input (guint rec_size, YadRecordKeyFunc key_func, YadLinesFunc func, gpointer data);
+
+/* indexed completion of entries */
+void set_completion (GtkWidget * entry, gchar ** items, gboolean fuzzy);
+void set_completion_command (GtkWidget * entry, const gchar * cmd);
+
+/* throttled output of changed values for --print-changes. value is formatted as in dialog output,
+ * num is a number of value in dialogs with several values or 0 */
+void print_change (guint num, const gchar * value);
+void flush_changes (void);
+
 static inline void
 strip_new_line (gchar * str)
 {